@@ -4,6 +4,7 @@
 #include <vector>
 #include <cstdlib>
 #include <cassert>
+#include <chrono>
 
 template <class Data> class Diff
 {
@@ -217,6 +218,12 @@ typedef struct s_xdalgoenv {
 	long mxcost;
 	long snake_cnt;
 	long heur_min;
+	long max_cost;     /* edit cost at which a split gives up even when minimal, 0 for no limit */
+	int has_deadline;
+	std::chrono::steady_clock::time_point deadline;
+	long ticks;        /* splitting steps since the clock was last read */
+	int expired;       /* the deadline has passed, so no split has to be minimal anymore */
+	int truncated;     /* a limit cut a split short */
 } xdalgoenv_t;
 
 #endif /* #if !defined(XDIFFI_H) */
@@ -1144,15 +1151,15 @@ void *xdl_cha_alloc(chastore_t *cha) {
 
 long xdl_guess_lines(int pass, mmfile_t *mf, long sample) {
 	long nl = 0, size, tsize = 0;
-	char const *data, *cur, *top;
+	char const *cur;
 	const Data& dat = pass == 1 ? m_data1 : m_data2;
 
-	if ((cur = data = reinterpret_cast<const char *>(xdl_mmfile_first(mf, &size))) != NULL) {
-		for (top = data + size; nl < sample && cur < top; ) {
+	if ((cur = reinterpret_cast<const char *>(xdl_mmfile_first(mf, &size))) != NULL) {
+		for (; nl < sample && tsize < size; ) {
 			nl++;
+			tsize += dat.rowSize(cur);
 			cur = dat.next(cur);
 		}
-		tsize += (long) (cur - data);
 	}
 
 	if (nl && tsize)
@@ -1189,13 +1196,27 @@ int xdl_fall_back_diff(xdfenv_t *diff_env, xpparam_t const *xpp,
 	mmfile_t subfile1, subfile2;
 	xdfenv_t env;
 
+	/* records follow each other through Data::next(), not necessarily upwards in memory */
 	subfile1.ptr = (char *)diff_env->xdf1.recs[line1 - 1]->ptr;
-	subfile1.size = static_cast<long>(diff_env->xdf1.recs[line1 + count1 - 2]->ptr +
-		diff_env->xdf1.recs[line1 + count1 - 2]->size - subfile1.ptr);
+	subfile1.size = 0;
+	for (int i = line1 - 1; i < line1 + count1 - 1; i++)
+		subfile1.size += diff_env->xdf1.recs[i]->size;
 	subfile2.ptr = (char *)diff_env->xdf2.recs[line2 - 1]->ptr;
-	subfile2.size = static_cast<long>(diff_env->xdf2.recs[line2 + count2 - 2]->ptr +
-		diff_env->xdf2.recs[line2 + count2 - 2]->size - subfile2.ptr);
-	if (xdl_do_diff(&subfile1, &subfile2, xpp, &env) < 0)
+	subfile2.size = 0;
+	for (int i = line2 - 1; i < line2 + count2 - 1; i++)
+		subfile2.size += diff_env->xdf2.recs[i]->size;
+
+	/* the cached hashes are indexed by record, so point them at the start of the ranges */
+	const unsigned long *hashes1 = m_hashes1;
+	const unsigned long *hashes2 = m_hashes2;
+	if (hashes1)
+		m_hashes1 = hashes1 + line1 - 1;
+	if (hashes2)
+		m_hashes2 = hashes2 + line2 - 1;
+	const int ret = xdl_do_diff(&subfile1, &subfile2, xpp, &env);
+	m_hashes1 = hashes1;
+	m_hashes2 = hashes2;
+	if (ret < 0)
 		return -1;
 
 	memcpy(diff_env->xdf1.rchg + line1 - 1, env.xdf1.rchg, count1);
@@ -1243,6 +1264,18 @@ typedef struct s_xdpsplit {
 	int min_lo, min_hi;
 } xdpsplit_t;
 
+/*
+ * Whether the deadline of the diff has passed, after which the minimal splits go on
+ * like the default ones, with the heuristics and the XDL_MAX_COST cut. The clock is
+ * only read every few hundred steps.
+ */
+static int xdl_deadline_passed(xdalgoenv_t *xenv) {
+	if (xenv->has_deadline && !xenv->expired && (++xenv->ticks & 0xff) == 0 &&
+	    std::chrono::steady_clock::now() >= xenv->deadline)
+		xenv->expired = 1;
+	return xenv->expired;
+}
+
 /*
  * See "An O(ND) Difference Algorithm and its Variations", by Eugene Myers.
  * Basically considers a "box" (off1, off2, lim1, lim2) and scan from both
@@ -1262,6 +1295,7 @@ static long xdl_split(unsigned long const *ha1, long off1, long lim1,
 	long fmin = fmid, fmax = fmid;
 	long bmin = bmid, bmax = bmid;
 	long ec, d, i1, i2, prev1, best, dd, v, k;
+	int over_cost;
 
 	/*
 	 * Set initial diagonal values for both forward and backward path.
@@ -1342,8 +1376,12 @@ static long xdl_split(unsigned long const *ha1, long off1, long lim1,
 			}
 		}
 
-		if (need_min)
-			continue;
+		over_cost = xenv->max_cost > 0 && ec >= xenv->max_cost;
+		if (need_min) {
+			if (!over_cost && !xdl_deadline_passed(xenv))
+				continue;
+			xenv->truncated = 1;
+		}
 
 		/*
 		 * If the edit cost is above the heuristic trigger and if
@@ -1409,9 +1447,12 @@ static long xdl_split(unsigned long const *ha1, long off1, long lim1,
 		 * Enough is enough. We spent too much time here and now we collect
 		 * the furthest reaching path using the (i1 + i2) measure.
 		 */
-		if (ec >= xenv->mxcost) {
+		if (ec >= xenv->mxcost || over_cost) {
 			long fbest, fbest1, bbest, bbest1;
 
+			if (ec < xenv->mxcost)
+				xenv->truncated = 1;
+
 			fbest = fbest1 = -1;
 			for (d = fmax; d >= fmin; d -= 2) {
 				i1 = XDL_MIN(kvdf[d], lim1);
@@ -1555,6 +1596,12 @@ int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 		xenv.mxcost = XDL_MAX_COST_MIN;
 	xenv.snake_cnt = XDL_SNAKE_CNT;
 	xenv.heur_min = XDL_HEUR_MIN_COST;
+	xenv.max_cost = m_maxCost;
+	xenv.has_deadline = m_timeLimit.count() > 0;
+	xenv.deadline = m_deadline;
+	xenv.ticks = 0;
+	xenv.expired = 0;
+	xenv.truncated = 0;
 
 	dd1.nrec = xe->xdf1.nreff;
 	dd1.ha = xe->xdf1.ha;
@@ -1574,6 +1621,8 @@ int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 	}
 
 	xdl_free(kvd);
+	if (xenv.truncated)
+		m_truncated = true;
 
 	return 0;
 }
@@ -1728,15 +1777,17 @@ int xdl_classify_record(unsigned int pass, xdlclassifier_t *cf, xrecord_t **rhas
 int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_t const *xpp,
 			   xdlclassifier_t *cf, xdfile_t *xdf) {
 	unsigned int hbits;
-	long nrec, hsize, bsize;
+	long nrec, hsize, bsize, pos, rsize;
 	unsigned long hav;
-	char const *blk, *cur, *top, *prev;
+	char const *cur, *prev;
 	xrecord_t *crec;
 	xrecord_t **recs, **rrecs;
 	xrecord_t **rhash;
 	unsigned long *ha;
 	char *rchg;
 	long *rindex;
+	const Data& data = ((pass == 1) ? m_data1 : m_data2);
+	const unsigned long *hashes = ((pass == 1) ? m_hashes1 : m_hashes2);
 
 	ha = NULL;
 	rindex = NULL;
@@ -1759,13 +1810,12 @@ int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_t const
 		memset(rhash, 0, hsize * sizeof(xrecord_t *));
 	}
 
-	const Data& data = ((pass == 1) ? m_data1 : m_data2);
-
 	nrec = 0;
-	if ((cur = blk = reinterpret_cast<const char *>(xdl_mmfile_first(mf, &bsize))) != NULL) {
-		for (top = blk + bsize; cur < top; ) {
+	if ((cur = reinterpret_cast<const char *>(xdl_mmfile_first(mf, &bsize))) != NULL) {
+		for (pos = 0; pos < bsize; pos += rsize) {
 			prev = cur;
-			hav = data.hash(cur);
+			rsize = data.rowSize(cur);
+			hav = hashes ? hashes[nrec] : data.hash(cur);
 			cur = data.next(cur);
 			if (nrec >= narec) {
 				narec *= 2;
@@ -1776,7 +1826,7 @@ int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_t const
 			if (!(crec = reinterpret_cast<s_xrecord *>(xdl_cha_alloc(&xdf->rcha))))
 				goto abort;
 			crec->ptr = prev;
-			crec->size = (long) (cur - prev);
+			crec->size = rsize;
 			crec->ha = hav;
 			recs[nrec++] = crec;
 
@@ -2059,8 +2109,30 @@ int xdl_optimize_ctxs(xdlclassifier_t *cf, xdfile_t *xdf1, xdfile_t *xdf2) {
 public:
 	enum Algorithm { MYERS, MINIMAL, PATIENCE, HISTOGRAM, NONE };
 
-	Diff(const Data& data1, const Data& data2)
-		: m_data1(data1), m_data2(data2) { }
+	// Data walks its rows in order: data() is the first row, next(row) the one after it,
+	// rowSize(row) the bytes of a row and size() the bytes of all of them. Rows do not
+	// have to follow each other in memory, so a bottom-up bitmap can be walked in place.
+	// hashes1 and hashes2, when given, hold the hashes of the rows in order and are used
+	// instead of Data::hash(), so that the hashes of unchanged data can be reused.
+
+	Diff(const Data& data1, const Data& data2,
+		const unsigned long *hashes1 = nullptr, const unsigned long *hashes2 = nullptr)
+		: m_data1(data1), m_data2(data2), m_hashes1(hashes1), m_hashes2(hashes2)
+		, m_maxCost(0), m_timeLimit(0), m_truncated(false) { }
+
+	// Bounds the Myers algorithm, also where patience and histogram fall back to it: a split
+	// gives up looking for a shorter path at maxCost edits and takes the furthest reaching
+	// one, as the default algorithm does past XDL_MAX_COST. Once the diff has run for
+	// timeLimitMs, MINIMAL goes on like the default algorithm. Either way the result stays
+	// close to minimal. 0 for no limit.
+	void setLimits(long maxCost, long timeLimitMs)
+	{
+		m_maxCost = maxCost;
+		m_timeLimit = std::chrono::milliseconds(timeLimitMs);
+	}
+
+	// Whether a limit cut the last diff short, so that it may not be the one without limits
+	bool truncated() const { return m_truncated; }
 
 	int diff(Algorithm algo, std::vector<char>& edscript)
 	{
@@ -2068,6 +2140,9 @@ public:
 		xdfenv_t env;
 		xpparam_t xpp{};
 
+		m_truncated = false;
+		m_deadline = std::chrono::steady_clock::now() + m_timeLimit;
+
 		file1.ptr = (char*)m_data1.data();
 		file1.size = m_data1.size();
 		file2.ptr = (char*)m_data2.data();
@@ -2141,5 +2216,11 @@ public:
 private:
 	const Data& m_data1;
 	const Data& m_data2;
+	const unsigned long *m_hashes1;
+	const unsigned long *m_hashes2;
+	long m_maxCost;
+	std::chrono::milliseconds m_timeLimit;
+	std::chrono::steady_clock::time_point m_deadline;
+	bool m_truncated;
 };
 
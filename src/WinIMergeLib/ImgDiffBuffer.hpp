@@ -1,2394 +1,4177 @@
-/////////////////////////////////////////////////////////////////////////////
-//    License (GPLv2+):
-//    This program is free software; you can redistribute it and/or modify
-//    it under the terms of the GNU General Public License as published by
-//    the Free Software Foundation; either version 2 of the License, or
-//    (at your option) any later version.
-//
-//    This program is distributed in the hope that it will be useful, but
-//    WITHOUT ANY WARRANTY; without even the implied warranty of
-//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-//    General Public License for more details.
-//
-//    You should have received a copy of the GNU General Public License
-//    along with this program; if not, write to the Free Software
-//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
-/////////////////////////////////////////////////////////////////////////////
-
-#pragma once
-
-#include "image.hpp"
-#include "ImgConverter.hpp"
-#include "Diff.hpp"
-#include <string>
-#include <algorithm>
-#include <cstdio>
-#include <cstring>
-#include <cmath>
-#include <vector>
-#include <chrono>
-#include <cmath>
-#include <cassert>
-
-enum OP_TYPE
-{
-	OP_NONE = 0, OP_1STONLY, OP_2NDONLY, OP_3RDONLY, OP_DIFF, OP_TRIVIAL
-};
-
-template<class T> struct Point
-{
-	Point(): x(0), y(0) {}
-	Point(T x, T y): x(x), y(y) {}
-	T x, y;
-};
-
-template<class T> struct Size
-{
-	Size(T cx, T cy): cx(cx), cy(cy) {}
-	T cx, cy;
-};
-
-template<class T> struct Rect
-{
-	Rect(T left, T top, T right, T bottom): left(left), top(top), right(right), bottom(bottom) {}
-	T left, top, right, bottom;
-};
-
-template <class T> struct Array2D
-{
-	Array2D() : m_width(0), m_height(0), m_data(NULL)
-	{
-	}
-
-	Array2D(size_t width, size_t height) : m_width(width), m_height(height), m_data(new T[width * height])
-	{
-		memset(m_data, 0, m_width * m_height * sizeof(T));
-	}
-
-	Array2D(const Array2D& other) : m_width(other.m_width), m_height(other.m_height), m_data(new T[other.m_width * other.m_height])
-	{
-		memcpy(m_data, other.m_data, m_width * m_height * sizeof(T));
-	}
-
-	Array2D& operator=(const Array2D& other)
-	{
-		if (this != &other)
-		{
-			delete[] m_data;
-			m_width  = other.m_width;
-			m_height = other.m_height;
-			m_data = new T[other.m_width * other.m_height];
-			memcpy(m_data, other.m_data, m_width * m_height * sizeof(T));
-		}
-		return *this;
-	}
-
-	~Array2D()
-	{
-		delete[] m_data;
-	}
-
-	void resize(size_t width, size_t height)
-	{
-		delete[] m_data;
-		m_data = new T[width * height];
-		m_width  = width;
-		m_height = height;
-		memset(m_data, 0, sizeof(T) * width * height);
-	}
-
-	T& operator()(int x, int y)
-	{
-		return m_data[y * m_width + x];
-	}
-
-	const T& operator()(int x, int y) const
-	{
-		return m_data[y * m_width + x];
-	}
-
-	void clear()
-	{
-		delete[] m_data;
-		m_data = NULL;
-		m_width = 0;
-		m_height = 0;
-	}
-
-	size_t height() const
-	{
-		return m_height;
-	}
-
-	size_t width() const
-	{
-		return m_width;
-	}
-
-	size_t m_width, m_height;
-	T* m_data;
-};
-
-struct DiffInfo
-{
-	DiffInfo(int op, int x, int y) : op(op), rc(x, y, x + 1, y + 1) {}
-	int op;
-	Rect<int> rc;
-};
-
-struct LineDiffInfo
-{
-	LineDiffInfo(int s1 = 0, int e1 = 0, int s2 = 0, int e2 = 0, int s3 = 0, int e3 = 0) :
-		begin{ s1, s2, s3 }, end{ e1, e2, e3 },
-		dbegin(0), dend{ -1, -1, -1 }, dendmax(-1), op(OP_DIFF) {}
-
-	LineDiffInfo(const LineDiffInfo& src) :
-		begin{ src.begin[0], src.begin[1], src.begin[2] },
-		end{ src.end[0], src.end[1], src.end[2] }, 
-		dbegin(src.dbegin),
-		dend{ src.dend[0], src.dend[1], src.dend[2] }, 
-		dendmax(src.dendmax), op(src.op)
-	{}
-
-	int begin[3];
-	int end[3];
-	int dbegin;
-	int dend[3];
-	int dendmax;
-	int op;
-};
-
-struct DiffStat { int d1, d2, d3, detc; };
-
-namespace
-{
-	int GetColorDistance2(Image::Color c1, Image::Color c2)
-	{
-		int rdist = Image::valueR(c1) - Image::valueR(c2);
-		int gdist = Image::valueG(c1) - Image::valueG(c2);
-		int bdist = Image::valueB(c1) - Image::valueB(c2);
-		int adist = Image::valueA(c1) - Image::valueA(c2);
-		return rdist * rdist + gdist * gdist + bdist * bdist + adist * adist;
-	}
-
-	/* diff3 algorithm. It is almost the same as GNU diff3's algorithm */
-	template<typename Element, typename Comp02Func>
-	std::vector<Element> Make3WayLineDiff(const std::vector<Element>& diff10, const std::vector<Element>& diff12,
-		Comp02Func cmpfunc)
-	{
-		std::vector<Element> diff3;
-
-		size_t diff10count = diff10.size();
-		size_t diff12count = diff12.size();
-
-		size_t diff10i = 0;
-		size_t diff12i = 0;
-		size_t diff3i = 0;
-
-		bool firstDiffBlockIsDiff12;
-
-		Element dr3, dr10, dr12, dr10first, dr10last, dr12first, dr12last;
-
-		int linelast0 = 0;
-		int linelast1 = 0;
-		int linelast2 = 0;
-
-		for (;;)
-		{
-			if (diff10i >= diff10count && diff12i >= diff12count)
-				break;
-
-			/*
-			 * merge overlapped diff blocks
-			 * diff10 is diff blocks between file1 and file0.
-			 * diff12 is diff blocks between file1 and file2.
-			 *
-			 *                      diff12
-			 *                 diff10            diff3
-			 *                 |~~~|             |~~~|
-			 * firstDiffBlock  |   |             |   |
-			 *                 |   | |~~~|       |   |
-			 *                 |___| |   |       |   |
-			 *                       |   |   ->  |   |
-			 *                 |~~~| |___|       |   |
-			 * lastDiffBlock   |   |             |   |
-			 *                 |___|             |___|
-			 */
-
-			if (diff10i >= diff10count && diff12i < diff12count)
-			{
-				dr12first = diff12.at(diff12i);
-				dr12last = dr12first;
-				firstDiffBlockIsDiff12 = true;
-			}
-			else if (diff10i < diff10count && diff12i >= diff12count)
-			{
-				dr10first = diff10.at(diff10i);
-				dr10last = dr10first;
-				firstDiffBlockIsDiff12 = false;
-			}
-			else
-			{
-				dr10first = diff10.at(diff10i);
-				dr12first = diff12.at(diff12i);
-				dr10last = dr10first;
-				dr12last = dr12first;
-				if (dr12first.begin[0] <= dr10first.begin[0])
-					firstDiffBlockIsDiff12 = true;
-				else
-					firstDiffBlockIsDiff12 = false;
-			}
-			bool lastDiffBlockIsDiff12 = firstDiffBlockIsDiff12;
-
-			size_t diff10itmp = diff10i;
-			size_t diff12itmp = diff12i;
-			for (;;)
-			{
-				if (diff10itmp >= diff10count || diff12itmp >= diff12count)
-					break;
-
-				dr10 = diff10.at(diff10itmp);
-				dr12 = diff12.at(diff12itmp);
-
-				if (dr10.end[0] == dr12.end[0])
-				{
-					diff10itmp++;
-					lastDiffBlockIsDiff12 = true;
-
-					dr10last = dr10;
-					dr12last = dr12;
-					break;
-				}
-
-				if (lastDiffBlockIsDiff12)
-				{
-					if ((std::max)(dr12.begin[0], dr12.end[0]) < dr10.begin[0])
-						break;
-				}
-				else
-				{
-					if ((std::max)(dr10.begin[0], dr10.end[0]) < dr12.begin[0])
-						break;
-				}
-
-				if (dr12.end[0] > dr10.end[0])
-				{
-					diff10itmp++;
-					lastDiffBlockIsDiff12 = true;
-				}
-				else
-				{
-					diff12itmp++;
-					lastDiffBlockIsDiff12 = false;
-				}
-
-				dr10last = dr10;
-				dr12last = dr12;
-			}
-
-			if (lastDiffBlockIsDiff12)
-				diff12itmp++;
-			else
-				diff10itmp++;
-
-			if (firstDiffBlockIsDiff12)
-			{
-				dr3.begin[1] = dr12first.begin[0];
-				dr3.begin[2] = dr12first.begin[1];
-				if (diff10itmp == diff10i)
-					dr3.begin[0] = dr3.begin[1] - linelast1 + linelast0;
-				else
-					dr3.begin[0] = dr3.begin[1] - dr10first.begin[0] + dr10first.begin[1];
-			}
-			else
-			{
-				dr3.begin[0] = dr10first.begin[1];
-				dr3.begin[1] = dr10first.begin[0];
-				if (diff12itmp == diff12i)
-					dr3.begin[2] = dr3.begin[1] - linelast1 + linelast2;
-				else
-					dr3.begin[2] = dr3.begin[1] - dr12first.begin[0] + dr12first.begin[1];
-			}
-
-			if (lastDiffBlockIsDiff12)
-			{
-				dr3.end[1] = dr12last.end[0];
-				dr3.end[2] = dr12last.end[1];
-				if (diff10itmp == diff10i)
-					dr3.end[0] = dr3.end[1] - linelast1 + linelast0;
-				else
-					dr3.end[0] = dr3.end[1] - dr10last.end[0] + dr10last.end[1];
-			}
-			else
-			{
-				dr3.end[0] = dr10last.end[1];
-				dr3.end[1] = dr10last.end[0];
-				if (diff12itmp == diff12i)
-					dr3.end[2] = dr3.end[1] - linelast1 + linelast2;
-				else
-					dr3.end[2] = dr3.end[1] - dr12last.end[0] + dr12last.end[1];
-			}
-
-			linelast0 = dr3.end[0] + 1;
-			linelast1 = dr3.end[1] + 1;
-			linelast2 = dr3.end[2] + 1;
-
-			if (diff10i == diff10itmp)
-				dr3.op = OP_3RDONLY;
-			else if (diff12i == diff12itmp)
-				dr3.op = OP_1STONLY;
-			else
-			{
-				if (!cmpfunc(dr3))
-					dr3.op = OP_DIFF;
-				else
-					dr3.op = OP_2NDONLY;
-			}
-
-			diff3.push_back(dr3);
-
-			diff3i++;
-			diff10i = diff10itmp;
-			diff12i = diff12itmp;
-		}
-
-		for (size_t i = 0; i < diff3i; i++)
-		{
-			Element& dr3r = diff3.at(i);
-			if (i < diff3i - 1)
-			{
-				Element& dr3next = diff3.at(i + 1);
-				for (int j = 0; j < 3; j++)
-				{
-					if (dr3r.end[j] >= dr3next.begin[j])
-						dr3r.end[j] = dr3next.begin[j] - 1;
-				}
-			}
-		}
-
-		return diff3;
-	}
-
-	bool alineEquals(const unsigned char* scanline1, unsigned width1,
-		const unsigned char* scanline2, unsigned width2, double colorDistanceThreshold)
-	{
-		if (width1 != width2)
-			return false;
-		if (colorDistanceThreshold > 0)
-		{
-			for (unsigned x = 0; x < width1; ++x)
-			{
-				int bdist = scanline1[x * 4 + 0] - scanline2[x * 4 + 0];
-				int gdist = scanline1[x * 4 + 1] - scanline2[x * 4 + 1];
-				int rdist = scanline1[x * 4 + 2] - scanline2[x * 4 + 2];
-				int adist = scanline1[x * 4 + 3] - scanline2[x * 4 + 3];
-				int colorDistance2 = rdist * rdist + gdist * gdist + bdist * bdist + adist * adist;
-				if (colorDistance2 > colorDistanceThreshold * colorDistanceThreshold)
-					return false;
-			}
-			return true;
-		}
-		else
-		{
-			return (memcmp(scanline1, scanline2, width1 * 4) == 0);
-		}
-	}
-
-	bool alineEquals(const Image& img1, const Image& img2,
-		unsigned y1, unsigned y2, double colorDistanceThreshold)
-	{
-		return alineEquals(img1.scanLine(y1), img1.width(), img2.scanLine(y2), img2.width(), colorDistanceThreshold);
-	}
-}
-
-class DataForDiff
-{
-public:
-	DataForDiff(const Image& img, double colorDistanceThreshold)
-		: m_img(img), m_colorDistanceThreshold(colorDistanceThreshold)
-	{
-		reverse();
-	}
-	~DataForDiff()
-	{
-		reverse();
-	}
-	void reverse()
-	{
-		unsigned w = m_img.width();
-		unsigned h = m_img.height();
-		std::vector<BYTE> tmp(w * 4);
-		for (unsigned i = 0; i < h / 2; ++i)
-		{
-			memcpy(tmp.data(), m_img.scanLine(i), w * 4);
-			memcpy(const_cast<BYTE *>(m_img.scanLine(i)), m_img.scanLine(h - i - 1), w * 4);
-			memcpy(const_cast<BYTE *>(m_img.scanLine(h - i - 1)), tmp.data(), w * 4);
-		}
-	}
-	unsigned size() const { return m_img.height() * m_img.width() * 4; }
-	const char* data() const { return reinterpret_cast<const char *>(m_img.scanLine(m_img.height() - 1)); }
-	const char* next(const char* scanline) const
-	{
-		return scanline + m_img.width() * 4;
-	}
-	bool equals(const char* scanline1, unsigned size1,
-		const char* scanline2, unsigned size2) const
-	{
-		return alineEquals(reinterpret_cast<const unsigned char *>(scanline1), size1 / 4, 
-			reinterpret_cast<const unsigned char *>(scanline2), size2 / 4, m_colorDistanceThreshold);
-	}
-	unsigned long hash(const char* scanline) const
-	{
-		unsigned long ha = 5381;
-		const char* begin = scanline;
-		const char* end = begin + m_img.width() * 4;
-
-		if (m_colorDistanceThreshold > 0.0)
-		{
-			int w = static_cast<int>(sqrt((m_colorDistanceThreshold * m_colorDistanceThreshold) / 3.0)) * 2;
-			if (w == 0)
-				w = 1;
-			for (const auto* ptr = begin; ptr < end; ptr++)
-			{
-				ha += (ha << 5);
-				ha ^= ((*ptr / w) * w) & 0xFF;
-			}
-		}
-		else
-		{
-			for (const auto* ptr = begin; ptr < end; ptr++)
-			{
-				ha += (ha << 5);
-				ha ^= *ptr & 0xFF;
-			}
-		}
-		return ha;
-	}
-
-private:
-	const Image& m_img;
-	double m_colorDistanceThreshold;
-};
-
-class CImgDiffBuffer
-{
-	friend class TemporaryTransformation;
-	typedef Array2D<int> DiffBlocks;
-
-public:
-	enum INSERTION_DELETION_DETECTION_MODE {
-		INSERTION_DELETION_DETECTION_NONE = 0, INSERTION_DELETION_DETECTION_VERTICAL, INSERTION_DELETION_DETECTION_HORIZONTAL
-	};
-	enum OVERLAY_MODE {
-		OVERLAY_NONE = 0, OVERLAY_XOR, OVERLAY_ALPHABLEND, OVERLAY_ALPHABLEND_ANIM
-	};
-	enum WIPE_MODE {
-		WIPE_NONE = 0, WIPE_VERTICAL, WIPE_HORIZONTAL
-	};
-	enum DIFF_ALGORITHM {
-		MYERS_DIFF, MINIMAL_DIFF, PATIENCE_DIFF, HISTOGRAM_DIFF, NONE_DIFF
-	};
-	
-	enum { BLINK_INTERVAL = 800 };
-	enum { OVERLAY_ANIMATION_INTERVAL = 1000 };
-
-	CImgDiffBuffer() : 
-		  m_nImages(0)
-		, m_showDifferences(true)
-		, m_blinkDifferences(false)
-		, m_vectorImageZoomRatio(1.0f)
-		, m_insertionDeletionDetectionMode(INSERTION_DELETION_DETECTION_NONE)
-		, m_overlayMode(OVERLAY_NONE)
-		, m_overlayAlpha(0.3)
-		, m_wipeMode(WIPE_NONE)
-		, m_wipePosition(0)
-		, m_wipePosition_old(INT_MAX)
-		, m_diffBlockSize(8)
-		, m_selDiffColor(Image::Rgb(0xff, 0x40, 0x40))
-		, m_selDiffDeletedColor(Image::Rgb(0xf0, 0xc0, 0xc0))
-		, m_diffColor(Image::Rgb(0xff, 0xff, 0x40))
-		, m_diffDeletedColor(Image::Rgb(0xc0, 0xc0, 0xc0))
-		, m_diffColorAlpha(0.7)
-		, m_colorDistanceThreshold(0.0)
-		, m_currentDiffIndex(-1)
-		, m_diffCount(0)
-		, m_angle{}
-		, m_horizontalFlip{}
-		, m_verticalFlip{}
-		, m_temporarilyTransformed(false)
-		, m_diffAlgorithm(MYERS_DIFF)
-		, m_blinkInterval(BLINK_INTERVAL)
-		, m_overlayAnimationInterval(OVERLAY_ANIMATION_INTERVAL)
-		, m_lastErrorCode(0)
-	{
-		for (int i = 0; i < 3; ++i)
-			m_currentPage[i] = 0;
-		for (int i = 0; i < 3; ++i)
-		{
-			m_imgDiffIsTransparent[i] = false;
-		}
-	}
-
-	virtual ~CImgDiffBuffer()
-	{
-		CloseImages();
-	}
-
-	const wchar_t *GetFileName(int pane)
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return NULL;
-		return m_filename[pane].c_str();
-	}
-
-	int GetPaneCount() const
-	{
-		return m_nImages;
-	}
-
-	bool IsAnyPaneTransparent() const
-	{
-		for (int i = 0; i < m_nImages; ++i)
-			if (m_imgDiffIsTransparent[i])
-				return true;
-		return false;
-	}
-
-	bool IsPaneTransparent(int pane) const
-	{
-		return (pane >= 0 && pane < m_nImages) ? m_imgDiffIsTransparent[pane] : false;
-	}
-
-	Image::Color GetPixelColor(int pane, int x, int y) const
-	{
-		return m_imgPreprocessed[pane].pixel(x - m_offset[pane].x, y - m_offset[pane].y);
-	}
-
-	double GetColorDistance(int pane1, int pane2, int x, int y) const
-	{
-		return std::sqrt(static_cast<double>(
-			::GetColorDistance2(GetPixelColor(pane1, x, y), GetPixelColor(pane2, x, y)) ));
-	}
-
-	Image::Color GetDiffColor() const
-	{
-		return m_diffColor;
-	}
-
-	void SetDiffColor(Image::Color clrDiffColor)
-	{
-		if (memcmp(&m_diffColor, &clrDiffColor, sizeof(m_diffColor)) == 0)
-			return;
-		m_diffColor = clrDiffColor;
-		RefreshImages();
-	}
-
-	Image::Color GetDiffDeletedColor() const
-	{
-		return m_diffDeletedColor;
-	}
-
-	void SetDiffDeletedColor(Image::Color clrDiffDeletedColor)
-	{
-		if (memcmp(&m_diffDeletedColor, &clrDiffDeletedColor, sizeof(m_diffDeletedColor)) == 0)
-			return;
-		m_diffDeletedColor = clrDiffDeletedColor;
-		RefreshImages();
-	}
-
-	Image::Color GetSelDiffColor() const
-	{
-		return m_selDiffColor;
-	}
-
-	void SetSelDiffColor(Image::Color clrSelDiffColor)
-	{
-		if (memcmp(&m_selDiffColor, &clrSelDiffColor, sizeof(m_selDiffColor)) == 0)
-			return;
-		m_selDiffColor = clrSelDiffColor;
-		RefreshImages();
-	}
-
-	Image::Color GetSelDiffDeletedColor() const
-	{
-		return m_selDiffDeletedColor;
-	}
-
-	void SetSelDiffDeletedColor(Image::Color clrSelDiffDeletedColor)
-	{
-		if (memcmp(&m_selDiffDeletedColor, &clrSelDiffDeletedColor, sizeof(m_selDiffDeletedColor)) == 0)
-			return;
-		m_selDiffDeletedColor = clrSelDiffDeletedColor;
-		RefreshImages();
-	}
-
-	double GetDiffColorAlpha() const
-	{
-		return m_diffColorAlpha;
-	}
-
-	void SetDiffColorAlpha(double diffColorAlpha)
-	{
-		if (m_diffColorAlpha == diffColorAlpha)
-			return;
-		m_diffColorAlpha = diffColorAlpha;
-		RefreshImages();
-	}
-
-	int  GetCurrentPage(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return -1;
-		return m_currentPage[pane];
-	}
-
-	void SetCurrentPage(int pane, int page)
-	{
-		if (page >= 0 && page < GetPageCount(pane))
-		{
-			if (m_currentPage[pane] != page &&
-			    (m_imgOrigMultiPage[pane].isValid() || m_imgConverter[pane].isValid()))
-			{
-				m_currentPage[pane] = page;
-				ChangePage(pane, page);
-				CompareImages();
-			}
-		}
-	}
-
-	void SetCurrentPageAll(int page)
-	{
-		bool frecompare = false;
-		for (int pane = 0; pane < m_nImages; ++pane)
-		{
-			if (page >= 0 && page < GetPageCount(pane))
-			{
-				if (m_currentPage[pane] != page &&
-				    (m_imgOrigMultiPage[pane].isValid() || m_imgConverter[pane].isValid()))
-				{
-					m_currentPage[pane] = page;
-					ChangePage(pane, page);
-					frecompare = true;
-				}
-			}
-		}
-		if (frecompare)
-			CompareImages();
-	}
-
-	int  GetCurrentMaxPage() const
-	{
-		int maxpage = 0;
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			int page = GetCurrentPage(i);
-			maxpage = maxpage < page ? page : maxpage;
-		}
-		return maxpage;
-	}
-
-	int  GetPageCount(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return -1;
-		if (m_imgOrigMultiPage[pane].isValid())
-			return m_imgOrigMultiPage[pane].getPageCount();
-		if (m_imgConverter[pane].isValid())
-			return m_imgConverter[pane].getPageCount();
-		else
-			return 1;
-	}
-
-	int  GetMaxPageCount() const
-	{
-		int maxpage = 0;
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			int page = GetPageCount(i);
-			maxpage = page > maxpage ? page : maxpage;
-		}
-		return maxpage;
-	}
-
-	double GetColorDistanceThreshold() const
-	{
-		return m_colorDistanceThreshold;
-	}
-
-	void SetColorDistanceThreshold(double threshold)
-	{
-		if (m_colorDistanceThreshold == threshold)
-			return;
-		m_colorDistanceThreshold = threshold;
-		CompareImages();
-	}
-
-	int  GetDiffBlockSize() const
-	{
-		return m_diffBlockSize;
-	}
-	
-	void SetDiffBlockSize(int blockSize)
-	{
-		if (m_diffBlockSize == blockSize)
-			return;
-		m_diffBlockSize = blockSize;
-		CompareImages();
-	}
-
-	INSERTION_DELETION_DETECTION_MODE GetInsertionDeletionDetectionMode() const
-	{
-		return m_insertionDeletionDetectionMode;
-	}
-
-	void SetInsertionDeletionDetectionMode(INSERTION_DELETION_DETECTION_MODE insertionDeletionDetectionMode)
-	{
-		if (m_insertionDeletionDetectionMode == insertionDeletionDetectionMode)
-			return;
-		m_insertionDeletionDetectionMode = insertionDeletionDetectionMode;
-		CompareImages();
-	}
-
-	OVERLAY_MODE GetOverlayMode() const
-	{
-		return m_overlayMode;
-	}
-
-	void SetOverlayMode(OVERLAY_MODE overlayMode)
-	{
-		if (m_overlayMode == overlayMode)
-			return;
-		m_overlayMode = overlayMode;
-		RefreshImages();
-	}
-
-	double GetOverlayAlpha() const
-	{
-		return m_overlayAlpha;
-	}
-
-	void SetOverlayAlpha(double overlayAlpha)
-	{
-		if (m_overlayAlpha == overlayAlpha)
-			return;
-		m_overlayAlpha = overlayAlpha;
-		RefreshImages();
-	}
-
-	WIPE_MODE GetWipeMode() const
-	{
-		return m_wipeMode;
-	}
-
-	void SetWipeMode(WIPE_MODE wipeMode)
-	{
-		if (m_wipeMode == wipeMode)
-			return;
-		m_wipeMode = wipeMode;
-		RefreshImages();
-		UpdateDiffTransparencyCache();
-	}
-
-	int GetWipePosition() const
-	{
-		return m_wipePosition;
-	}
-
-	void SetWipePosition(int pos)
-	{
-		if (m_wipePosition == pos)
-			return;
-		m_wipePosition = pos;
-		bool anyTransparent = IsAnyPaneTransparent();
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			if (m_imgDiffIsTransparent[i])
-			{
-				// Dummy operation with less performance to retrigger redrawing
-				// setPixelColor leads to _bHasChanged = TRUE which will enable redrawing
-				RGBQUAD color;
-				m_imgDiff[i].getFipImage()->getPixelColor(0, 0, &color);
-				m_imgDiff[i].getFipImage()->setPixelColor(0, 0, &color);
-			}
-			else if (anyTransparent)
-			{
-				// In mixed transparency scenarios (at least one transparent pane),
-				// non-transparent images must also be marked as modified so FreeImage
-				// rebuilds their internal DIB cache.
-				m_imgDiff[i].getFipImage()->setModified(true);
-			}
-		}
-		WipeEffect();
-	}
-
-
-	void SetWipeModePosition(WIPE_MODE wipeMode, int pos)
-	{
-		if (m_wipeMode == wipeMode && m_wipePosition == pos)
-			return;
-		m_wipeMode = wipeMode;
-		m_wipePosition = pos;
-		RefreshImages();
-		UpdateDiffTransparencyCache();
-		if (m_wipeMode != WIPE_NONE)
-			WipeEffect();
-	}
-
-	bool GetShowDifferences() const
-	{
-		return m_showDifferences;
-	}
-
-	void SetShowDifferences(bool visible)
-	{
-		if (m_showDifferences == visible)
-			return;
-		m_showDifferences = visible;
-		CompareImages();
-	}
-
-	bool GetBlinkDifferences() const
-	{
-		return m_blinkDifferences;
-	}
-
-	void SetBlinkDifferences(bool blink)
-	{
-		if (m_blinkDifferences == blink)
-			return;
-		m_blinkDifferences = blink;
-		RefreshImages();
-	}
-
-	float GetVectorImageZoomRatio() const
-	{
-		return m_vectorImageZoomRatio;
-	}
-
-	void SetVectorImageZoomRatio(float zoom)
-	{
-		if (m_vectorImageZoomRatio == zoom)
-			return;
-		m_vectorImageZoomRatio = zoom;
-		for (int pane = 0; pane < m_nImages; ++pane)
-		{
-			if (m_imgConverter[pane].isValid())
-				ChangePage(pane, m_currentPage[pane]);
-		}
-		CompareImages();
-	}
-
-	float GetRotation(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return 0.f;
-		return m_angle[pane];
-	}
-
-	void SetRotation(int pane, float angle)
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return;
-		if (angle >= 360.f)
-			angle = angle - 360.f * (static_cast<int>(angle) / 360);
-		else if (angle < 0.f)
-			angle = angle + 360.f * (1 + (static_cast<int>(-angle) / 360));
-		if (m_angle[pane] == angle)
-			return;
-		m_angle[pane] = angle;
-		CompareImages();
-	}
-
-	bool GetHorizontalFlip(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return false;
-		return m_horizontalFlip[pane];
-	}
-
-	void SetHorizontalFlip(int pane, bool flip)
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return;
-		if (m_horizontalFlip[pane] == flip)
-			return;
-		m_horizontalFlip[pane] = flip;
-		CompareImages();
-	}
-
-	bool GetVerticalFlip(int pane ) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return false;
-		return m_verticalFlip[pane];
-	}
-
-	void SetVerticalFlip(int pane, bool flip)
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return;
-		if (m_verticalFlip[pane] == flip)
-			return;
-		m_verticalFlip[pane] = flip;
-		CompareImages();
-	}
-
-	DIFF_ALGORITHM GetDiffAlgorithm() const
-	{
-		return m_diffAlgorithm;
-	}
-
-	void SetDiffAlgorithm(DIFF_ALGORITHM diffAlgorithm)
-	{
-		if (m_diffAlgorithm == diffAlgorithm)
-			return;
-		m_diffAlgorithm = diffAlgorithm;
-		CompareImages();
-	}
-
-	const DiffInfo *GetDiffInfo(int diffIndex) const
-	{
-		if (diffIndex < 0 || diffIndex >= m_diffCount)
-			return NULL;
-		return &m_diffInfos[diffIndex];
-	}
-
-	int  GetDiffCount() const
-	{
-		return m_diffCount;
-	}
-
-	int  GetConflictCount() const
-	{
-		int conflictCount = 0;
-		for (int i = 0; i < m_diffCount; ++i)
-			if (m_diffInfos[i].op == OP_DIFF)
-				++conflictCount;
-		return conflictCount;
-	}
-
-	int  GetCurrentDiffIndex() const
-	{
-		return m_currentDiffIndex;
-	}
-
-	bool FirstDiff()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		if (m_diffCount == 0)
-			m_currentDiffIndex = -1;
-		else
-			m_currentDiffIndex = 0;
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool LastDiff()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		m_currentDiffIndex = m_diffCount - 1;
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool NextDiff()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		++m_currentDiffIndex;
-		if (m_currentDiffIndex >= m_diffCount)
-			m_currentDiffIndex = m_diffCount - 1;
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool PrevDiff()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		if (m_diffCount == 0)
-			m_currentDiffIndex = -1;
-		else
-		{
-			--m_currentDiffIndex;
-			if (m_currentDiffIndex < 0)
-				m_currentDiffIndex = 0;
-		}
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool FirstConflict()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		for (size_t i = 0; i < m_diffInfos.size(); ++i)
-			if (m_diffInfos[i].op == OP_DIFF)
-				m_currentDiffIndex = static_cast<int>(i);
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool LastConflict()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		for (int i = static_cast<int>(m_diffInfos.size() - 1); i >= 0; --i)
-		{
-			if (m_diffInfos[i].op == OP_DIFF)
-			{
-				m_currentDiffIndex = i;
-				break;
-			}
-		}
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool NextConflict()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		for (size_t i = m_currentDiffIndex + 1; i < m_diffInfos.size(); ++i)
-		{
-			if (m_diffInfos[i].op == OP_DIFF)
-			{
-				m_currentDiffIndex = static_cast<int>(i);
-				break;
-			}
-		}
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool PrevConflict()
-	{
-		int oldDiffIndex = m_currentDiffIndex;
-		for (int i = m_currentDiffIndex - 1; i >= 0; --i)
-		{
-			if (m_diffInfos[i].op == OP_DIFF)
-			{
-				m_currentDiffIndex = i;
-				break;
-			}
-		}
-		if (oldDiffIndex == m_currentDiffIndex)
-			return false;
-		RefreshImages();
-		return true;
-	}
-
-	bool SelectDiff(int diffIndex)
-	{
-		if (diffIndex == m_currentDiffIndex || diffIndex < -1 || diffIndex >= m_diffCount)
-			return false;
-		m_currentDiffIndex = diffIndex;
-		RefreshImages();
-		return true;
-	}
-	
-	int  GetNextDiffIndex() const
-	{
-		if (m_diffCount == 0 || m_currentDiffIndex >= m_diffCount - 1)
-			return -1;
-		return m_currentDiffIndex + 1;
-	}
-
-	int  GetPrevDiffIndex() const
-	{
-		if (m_diffCount == 0 || m_currentDiffIndex <= 0)
-			return -1;
-		return m_currentDiffIndex - 1;
-	}
-
-	int  GetNextConflictIndex() const
-	{
-		for (size_t i = m_currentDiffIndex + 1; i < m_diffInfos.size(); ++i)
-			if (m_diffInfos[i].op == OP_DIFF)
-				return static_cast<int>(i);
-		return -1;
-	}
-
-	int  GetPrevConflictIndex() const
-	{
-		for (int i = static_cast<int>(m_currentDiffIndex - 1); i >= 0; --i)
-			if (m_diffInfos[i].op == OP_DIFF)
-				return i;
-		return -1;
-	}
-
-	void CompareImages()
-	{
-		if (m_nImages <= 1)
-			return;
-
-		PreprocessImages();
-
-		InitializeDiff();
-		if (m_nImages == 2)
-		{
-			CompareImages2(0, 1, m_diff);
-			m_diffCount = MarkDiffIndex(m_diff);
-		}
-		else if (m_nImages == 3)
-		{
-			CompareImages2(0, 1, m_diff01);
-			CompareImages2(2, 1, m_diff21);
-			CompareImages2(0, 2, m_diff02);
-			Make3WayDiff(m_diff01, m_diff21, m_diff);
-			m_diffCount = MarkDiffIndex3way(m_diff01, m_diff21, m_diff02, m_diff);
-		}
-		if (m_currentDiffIndex >= m_diffCount)
-			m_currentDiffIndex = m_diffCount - 1;
-		RefreshImages();
-	}
-
-	void RefreshImages()
-	{
-		if (m_nImages <= 1)
-			return;
-		InitializeDiffImages();
-		for (int i = 0; i < m_nImages; ++i)
-			CopyPreprocessedImageToDiffImage(i);
-		void (CImgDiffBuffer::*func)(int src, int dst) = NULL;
-		if (m_overlayMode == OVERLAY_ALPHABLEND || m_overlayMode == OVERLAY_ALPHABLEND_ANIM)
-			func = &CImgDiffBuffer::AlphaBlendImages2;
-		else if (m_overlayMode == OVERLAY_XOR)
-			func = &CImgDiffBuffer::XorImages2;
-		if (func)
-		{
-			if (m_nImages == 2)
-			{
-				(this->*func)(1, 0);
-				(this->*func)(0, 1);
-			}
-			else if (m_nImages == 3)
-			{
-				(this->*func)(1, 0);
-				(this->*func)(0, 1);
-				(this->*func)(2, 1);
-				(this->*func)(1, 2);
-			}
-		}
-		if (m_showDifferences)
-		{
-			bool showDiff = true;
-			if (m_blinkDifferences)
-			{
-				auto now = std::chrono::system_clock::now();
-				auto tse = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-				if ((tse.count() % m_blinkInterval) < m_blinkInterval / 2)
-				{
-					showDiff = false;
-				}
-
-			}
-			if (showDiff)
-			{
-				for (int i = 0; i < m_nImages; ++i)
-					MarkDiff(i, m_diff);
-			}
-		}
-		m_wipePosition_old = INT_MAX;
-		if (m_wipeMode != WIPE_NONE)
-		{
-			WipeEffect();
-		}
-		UpdateDiffTransparencyCache();
-	}
-
-	void UpdateDiffTransparencyCache()
-	{
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			m_imgDiffIsTransparent[i] = m_imgDiff[i].getFipImage()->isTransparent() ? true : false;
-		}
-	}
-
-	bool OpenImages(int nImages, const wchar_t * const filename[3])
-	{
-		CloseImages();
-		m_nImages = nImages;
-		for (int i = 0; i < nImages; ++i)
-			m_filename[i] = filename[i];
-		return LoadImages();
-	}
-
-	virtual bool CloseImages()
-	{
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			m_imgConverter[i].close();
-			m_imgOrigMultiPage[i].close();
-			m_imgOrig[i].clear();
-			m_imgOrig32[i].clear();
-			m_imgPreprocessed[i].clear();
-			m_offset[i].x = 0;
-			m_offset[i].y = 0;
-		}
-		m_nImages = 0;
-		return true;
-	}
-
-	bool SaveDiffImageAs(int pane, const wchar_t *filename)
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return false;
-		int savedErrno = errno;
-		errno = 0;
-		bool result = !!m_imgDiff[pane].save(filename);
-		if (!result)
-			m_lastErrorCode = errno != 0 ? errno : ENOTSUP;
-		if (errno == 0)
-			errno = savedErrno;
-		return result;
-	}
-
-	int  GetImageWidth(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return -1;
-		if (m_angle[pane] == 0.f || m_angle[pane] == 180.f)
-			return m_imgOrig32[pane].width();
-		else
-			return m_imgOrig32[pane].height();
-	}
-
-	int  GetImageHeight(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return -1;
-		if (m_angle[pane] == 0.f || m_angle[pane] == 180.f)
-			return m_imgOrig32[pane].height();
-		else
-			return m_imgOrig32[pane].width();
-	}
-
-	int  GetPreprocessedImageWidth(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return -1;
-		return m_imgPreprocessed[pane].width();
-	}
-
-	int  GetPreprocessedImageHeight(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return -1;
-		return m_imgPreprocessed[pane].height();
-	}
-
-	int  GetDiffImageWidth() const
-	{
-		if (m_nImages <= 0)
-			return -1;
-		return m_imgDiff[0].width();
-	}
-
-	int  GetDiffImageHeight() const
-	{
-		if (m_nImages <= 0)
-			return -1;
-		return m_imgDiff[0].height();
-	}
-
-	int  GetImageBitsPerPixel(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return -1;
-		return m_imgOrig[pane].depth();
-	}
-
-	int GetDiffIndexFromPoint(int x, int y) const
-	{
-		if (x > 0 && y > 0 && 
-			x < static_cast<int>(m_imgDiff[0].width()) &&
-			y < static_cast<int>(m_imgDiff[0].height()))
-		{
-			return m_diff(x / m_diffBlockSize, y / m_diffBlockSize) - 1;
-		}
-		return -1;
-	}
-
-	Image *GetImage(int pane)
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return NULL;
-		return &m_imgDiff[pane];
-	}
-
-	const Image *GetImage(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return NULL;
-		return &m_imgDiff[pane];
-	}
-
-	const Image *GetPreprocessedImage(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return NULL;
-		return &m_imgPreprocessed[pane];
-	}
-
-	const Image *GetOriginalImage(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return NULL;
-		return &m_imgOrig[pane];
-	}
-
-	Image *GetDiffMapImage(unsigned w, unsigned h)
-	{
-		m_imgDiffMap.clear();
-		m_imgDiffMap.setSize(w, h);
-		if (m_nImages == 0)
-			return &m_imgDiffMap;
-		double diffMapBlockSizeW = static_cast<double>(m_diffBlockSize) * w / m_imgDiff[0].width();
-		double diffMapBlockSizeH = static_cast<double>(m_diffBlockSize) * h / m_imgDiff[0].height();
-		for (unsigned by = 0; by < m_diff.height(); ++by)
-		{
-			for (unsigned bx = 0; bx < m_diff.width(); ++bx)
-			{
-				int diffIndex = m_diff(bx, by);
-				if (diffIndex != 0)
-				{
-					Image::Color color = (diffIndex - 1 == m_currentDiffIndex) ? m_selDiffColor : m_diffColor;
-					unsigned bsy = static_cast<unsigned>(diffMapBlockSizeH + 1);
-					unsigned y = static_cast<unsigned>(by * diffMapBlockSizeH);
-					if (y + bsy - 1 >= h)
-						bsy = h - y;
-					for (unsigned i = 0; i < bsy; ++i)
-					{
-						unsigned y = static_cast<unsigned>(by * diffMapBlockSizeH + i);
-						unsigned char *scanline = m_imgDiffMap.scanLine(y);
-						unsigned bsx = static_cast<unsigned>(diffMapBlockSizeW + 1);
-						unsigned x = static_cast<unsigned>(bx * diffMapBlockSizeW);
-						if (x + bsx - 1 >= w)
-							bsx = w - x;
-						for (unsigned j = 0; j < bsx; ++j)
-						{
-							unsigned x = static_cast<unsigned>(bx * diffMapBlockSizeW + j);
-							scanline[x * 4 + 0] = Image::valueB(color);
-							scanline[x * 4 + 1] = Image::valueG(color);
-							scanline[x * 4 + 2] = Image::valueR(color);
-							scanline[x * 4 + 3] = 0xff;
-						}
-					}
-				}
-			}
-		}
-		return &m_imgDiffMap;
-	}
-
-	Point<unsigned> GetImageOffset(int pane) const
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return Point<unsigned>();
-		return m_offset[pane];
-	}
-
-	void AddImageOffset(int pane, int dx, int dy)
-	{
-		if (pane < 0 || pane >= m_nImages)
-			return;
-		int minx = INT_MAX, miny = INT_MAX;
-		Point<int> offset[3];
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			offset[i].x = m_offset[i].x;
-			offset[i].y = m_offset[i].y;
-			if (i == pane)
-			{
-				offset[i].x += dx;
-				offset[i].y += dy;
-			}
-			if (offset[i].x < minx)
-				minx = offset[i].x;
-			if (offset[i].y < miny)
-				miny = offset[i].y;
-		}
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			m_offset[i].x = offset[i].x - minx;
-			m_offset[i].y = offset[i].y - miny;
-		}
-		CompareImages();
-		RefreshImages();
-	}
-
-	bool ConvertToRealPos(int pane, int x, int y, int& rx, int& ry, bool clamp = true) const
-	{
-		x -= m_offset[pane].x;
-		y -= m_offset[pane].y;
-
-		bool inside = true;
-		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_NONE ||
-			m_lineDiffInfos.size() == 0)
-		{
-			if (x < 0)
-			{
-				rx = clamp ? 0 : x;
-				inside = false;
-			}
-			else if (x >= static_cast<int>(m_imgPreprocessed[pane].width()))
-			{
-				rx = clamp ? (m_imgPreprocessed[pane].width() - 1) : x;
-				inside = false;
-			}
-			else
-				rx = x;
-			if (y < 0)
-			{
-				ry = clamp ? 0 : y;
-				inside = false;
-			}
-			else if (y >= static_cast<int>(m_imgPreprocessed[pane].height()))
-			{
-				ry = clamp ? (m_imgPreprocessed[pane].height() - 1) : y;
-				inside = false;
-			}
-			else
-				ry = y;
-			return inside;
-		}
-
-		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_VERTICAL)
-		{
-			if (x < 0)
-			{
-				rx = clamp ? 0 : x;
-				inside = false;
-			}
-			else if (x >= static_cast<int>(m_imgPreprocessed[pane].width()))
-			{
-				rx = clamp ? (m_imgPreprocessed[pane].width() - 1) : x;
-				inside = false;
-			}
-			else
-				rx = x;
-			for (auto& lineDiff: m_lineDiffInfos)
-			{
-				if (y <= lineDiff.dend[pane])
-				{
-					if (y < 0)
-					{
-						ry = clamp ? 0 : y;
-						inside = false;
-					}
-					else
-						ry = y - lineDiff.dbegin + lineDiff.begin[pane];
-					return inside;
-				}
-				else if (lineDiff.dend[pane] < y && y <= lineDiff.dendmax)
-				{
-					ry = lineDiff.end[pane];
-					inside = false;
-					return inside;
-				}
-			}
-			ry = y - m_lineDiffInfos.back().dendmax + m_lineDiffInfos.back().end[pane];
-			if (ry >= GetImageHeight(pane))
-			{
-				if (clamp)
-					ry = GetImageHeight(pane) - 1;
-				inside = false;
-			}
-			return inside;
-		}
-		else
-		{
-			if (y < 0)
-			{
-				ry = clamp ? 0 : y;
-				inside = false;
-			}
-			else if (y >= static_cast<int>(m_imgPreprocessed[pane].height()))
-			{
-				ry = clamp ? (m_imgPreprocessed[pane].height() - 1) : y;
-				inside = false;
-			}
-			else
-				ry = y;
-			for (auto& lineDiff: m_lineDiffInfos)
-			{
-				if (x <= lineDiff.dend[pane])
-				{
-					if (x < 0)
-					{
-						rx = clamp ? 0 : x;
-						inside = false;
-					}
-					else
-						rx = x - lineDiff.dbegin + lineDiff.begin[pane];
-					return inside;
-				}
-				else if (lineDiff.dend[pane] < x && x <= lineDiff.dendmax)
-				{
-					rx = lineDiff.end[pane];
-					inside = false;
-					return inside;
-				}
-			}
-			rx = x - m_lineDiffInfos.back().dendmax + m_lineDiffInfos.back().end[pane];
-			if (rx >= GetImageWidth(pane))
-			{
-				if (clamp)
-					rx = GetImageWidth(pane) - 1;
-				inside = false;
-			}
-			return inside;
-		}
-	}
-
-	void CopySubImage(int pane, int x, int y, int x2, int y2, Image& image)
-	{
-		TemporaryTransformation tmp(*this);
-		m_imgOrig32[pane].copySubImage(image, x, y, x2, y2);
-	}
-
-	int GetLastErrorCode() const
-	{
-		return m_lastErrorCode;
-	}
-
-protected:
-	bool LoadImages()
-	{
-		int savedErrno = errno;
-		errno = 0;
-		bool bSucceeded = true;
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			m_imgConverter[i].close();
-			m_currentPage[i] = 0;
-			m_imgOrigMultiPage[i].load(m_filename[i]);
-			if (m_imgOrigMultiPage[i].isValid() && m_imgOrigMultiPage[i].getPageCount() > 1)
-			{
-				m_imgOrig[i] = m_imgOrigMultiPage[i].getImage(0);
-				m_imgOrig32[i] = m_imgOrig[i];
-			}
-			else
-			{
-				m_imgOrigMultiPage[i].close();
-				if (!m_imgOrig[i].load(m_filename[i]))
-				{
-					if (ImgConverter::isSupportedImage(m_filename[i].c_str()))
-					{
-						if (m_imgConverter[i].load(m_filename[i].c_str()))
-							m_imgConverter[i].render(m_imgOrig[i], 0, m_vectorImageZoomRatio);
-					}
-					if (!m_imgConverter[i].isValid() && !m_filename[i].empty())
-					{
-						bSucceeded = false;
-						m_lastErrorCode = (errno != 0) ? errno : ENOTSUP;
-					}
-				}
-				m_imgOrig32[i] = m_imgOrig[i];
-				std::map<std::string, std::string> meta = m_imgOrig[i].getMetadata();
-				m_horizontalFlip[i] = false;
-				m_verticalFlip[i] = false;
-				m_angle[i] = 0.f;
-				std::string orientation = meta["EXIF_MAIN/Orientation"];
-				if (orientation == "top, right side") // 2
-					m_horizontalFlip[i] = true;
-				else if (orientation == "bottom, right side") // 3
-					m_angle[i] = 180.f;
-				else if (orientation == "bottom, left side") // 4
-					m_verticalFlip[i] = true;
-				else if (orientation == "left side, top") // 5
-				{
-					m_angle[i] = 90.f;
-					m_verticalFlip[i] = true;
-				}
-				else if (orientation == "right side, top") // 6
-					m_angle[i] = 270.f;
-				else if (orientation == "right side, bottom") // 7
-				{
-					m_angle[i] = 270.f;
-					m_verticalFlip[i] = true;
-				}
-				else if (orientation == "left side, bottom") // 8
-					m_angle[i] = 90.f;
-			}
-			m_imgOrig32[i].convertTo32Bits();
-		}
-		if (errno == 0)
-			errno = savedErrno;
-		return bSucceeded;
-	}
-
-	void ChangePage(int pane, int page)
-	{
-		if (m_imgOrigMultiPage[pane].isValid() || m_imgConverter[pane].isValid())
-		{
-			if (m_imgOrigMultiPage[pane].isValid())
-				m_imgOrig[pane] = m_imgOrigMultiPage[pane].getImage(page);
-			else
-				m_imgConverter[pane].render(m_imgOrig[pane], page, m_vectorImageZoomRatio);
-			m_imgOrig32[pane] = m_imgOrig[pane];
-			m_imgOrig32[pane].convertTo32Bits();
-			if (m_currentDiffIndex >= 0)
-				m_currentDiffIndex = 0;
-		}
-	}
-
-	Size<unsigned> GetMaxWidthHeight()
-	{
-		unsigned wmax = 0;
-		unsigned hmax = 0;
-		for (int i = 0; i < m_nImages; ++i)
-		{
-			wmax = (std::max)(wmax, static_cast<unsigned>(m_imgPreprocessed[i].width())  + m_offset[i].x);
-			hmax = (std::max)(hmax, static_cast<unsigned>(m_imgPreprocessed[i].height()) + m_offset[i].y);
-		}
-		return Size<unsigned>(wmax, hmax);
-	}
-
-	void InitializeDiff()
-	{
-		Size<unsigned> size = GetMaxWidthHeight();
-		int nBlocksX = (size.cx + m_diffBlockSize - 1) / m_diffBlockSize;
-		int nBlocksY = (size.cy + m_diffBlockSize - 1) / m_diffBlockSize;
-
-		m_diff.clear();
-		m_diff.resize(nBlocksX, nBlocksY);
-		if (m_nImages == 3)
-		{
-			m_diff01.clear();
-			m_diff01.resize(nBlocksX, nBlocksY);
-			m_diff21.clear();
-			m_diff21.resize(nBlocksX, nBlocksY);
-			m_diff02.clear();
-			m_diff02.resize(nBlocksX, nBlocksY);
-		}
-		m_diffInfos.clear();
-	}
-
-	void InitializeDiffImages()
-	{
-		Size<unsigned> size = GetMaxWidthHeight();
-		for (int i = 0; i < m_nImages; ++i)
-			m_imgDiff[i].setSize(size.cx, size.cy);
-	}
-
-	void CompareImages2(int pane1, int pane2, DiffBlocks& diff)
-	{
-		unsigned x1min = m_imgPreprocessed[pane1].width()  > 0 ? m_offset[pane1].x : -1;
-		unsigned y1min = m_imgPreprocessed[pane1].height() > 0 ? m_offset[pane1].y : -1;
-		unsigned x2min = m_imgPreprocessed[pane2].width()  > 0 ? m_offset[pane2].x : -1;
-		unsigned y2min = m_imgPreprocessed[pane2].height() > 0 ? m_offset[pane2].y : -1;
-		unsigned x1max = x1min + m_imgPreprocessed[pane1].width() - 1;
-		unsigned y1max = y1min + m_imgPreprocessed[pane1].height() - 1;
-		unsigned x2max = x2min + m_imgPreprocessed[pane2].width() - 1;
-		unsigned y2max = y2min + m_imgPreprocessed[pane2].height() - 1;
-
-		const unsigned wmax = (std::max)(x1max + 1, x2max + 1);
-		const unsigned hmax = (std::max)(y1max + 1, y2max + 1);
-
-		for (unsigned by = 0; by < diff.height(); ++by)
-		{
-			unsigned bsy = (hmax - by * m_diffBlockSize) >= m_diffBlockSize ? m_diffBlockSize : (hmax - by * m_diffBlockSize); 
-			for (unsigned i = 0; i < bsy; ++i)
-			{
-				unsigned y = by * m_diffBlockSize + i;
-				if (y < y1min || y > y1max || y < y2min || y > y2max)
-				{
-					for (unsigned bx = 0; bx < diff.width(); ++bx)
-						diff(bx, by) = -1;
-				}
-				else
-				{
-					const unsigned char *scanline1 = m_imgPreprocessed[pane1].scanLine(y - y1min);
-					const unsigned char *scanline2 = m_imgPreprocessed[pane2].scanLine(y - y2min);
-					if (x1min == x2min && x1max == x2max && m_colorDistanceThreshold == 0.0)
-					{
-						if (memcmp(scanline1, scanline2, (x2max + 1 - x1min) * 4) == 0)
-							continue;
-					}
-					for (unsigned x = 0; x < wmax; ++x)
-					{
-						if (x < x1min || x > x1max || x < x2min || x > x2max)
-							diff(x / m_diffBlockSize, by) = -1;
-						else
-						{
-							if (m_colorDistanceThreshold > 0.0)
-							{
-								int bdist = scanline1[(x - x1min) * 4 + 0] - scanline2[(x - x2min) * 4 + 0];
-								int gdist = scanline1[(x - x1min) * 4 + 1] - scanline2[(x - x2min) * 4 + 1];
-								int rdist = scanline1[(x - x1min) * 4 + 2] - scanline2[(x - x2min) * 4 + 2];
-								int adist = scanline1[(x - x1min) * 4 + 3] - scanline2[(x - x2min) * 4 + 3];
-								int colorDistance2 = rdist * rdist + gdist * gdist + bdist * bdist + adist * adist;
-								if (colorDistance2 > m_colorDistanceThreshold * m_colorDistanceThreshold)
-									diff(x / m_diffBlockSize, by) = -1;
-							}
-							else
-							{
-								if (scanline1[(x - x1min) * 4 + 0] != scanline2[(x - x2min) * 4 + 0] ||
-									scanline1[(x - x1min) * 4 + 1] != scanline2[(x - x2min) * 4 + 1] ||
-									scanline1[(x - x1min) * 4 + 2] != scanline2[(x - x2min) * 4 + 2] ||
-									scanline1[(x - x1min) * 4 + 3] != scanline2[(x - x2min) * 4 + 3])
-								{
-									diff(x / m_diffBlockSize, by) = -1;
-								}
-							}
-						}
-					}
-				}
-			}
-		}
-	}
-		
-	void FloodFill8Directions(DiffBlocks& data, int x, int y, unsigned val)
-	{
-		std::vector<Point<int> > stack;
-		stack.push_back(Point<int>(x, y));
-		while (!stack.empty())
-		{
-			const Point<int>& pt = stack.back();
-			const int x = pt.x;
-			const int y = pt.y;
-			stack.pop_back();
-			if (data(x, y) != -1)
-				continue;
-			data(x, y) = val;
-			if (x + 1 < static_cast<int>(data.width()))
-			{
-				stack.push_back(Point<int>(x + 1, y));
-				if (y + 1 < static_cast<int>(data.height()))
-					stack.push_back(Point<int>(x + 1, y + 1));
-				if (y - 1 >= 0)
-					stack.push_back(Point<int>(x + 1, y - 1));
-			}
-			if (x - 1 >= 0)
-			{
-				stack.push_back(Point<int>(x - 1, y));
-				if (y + 1 < static_cast<int>(data.height()))
-					stack.push_back(Point<int>(x - 1, y + 1));
-				if (y - 1 >= 0)
-					stack.push_back(Point<int>(x - 1, y - 1));
-			}
-			if (y + 1 < static_cast<int>(data.height()))
-				stack.push_back(Point<int>(x, y + 1));
-			if (y - 1 >= 0)
-				stack.push_back(Point<int>(x, y - 1));
-		}
-	}
-
-	int MarkDiffIndex(DiffBlocks& diff)
-	{
-		int diffCount = 0;
-		for (unsigned by = 0; by < diff.height(); ++by)
-		{
-			for (unsigned bx = 0; bx < diff.width(); ++bx)
-			{
-				int idx = diff(bx, by);
-				if (idx == -1)
-				{
-					m_diffInfos.push_back(DiffInfo(OP_DIFF, bx, by));
-					++diffCount;
-					FloodFill8Directions(diff, bx, by, diffCount);
-				}
-				else if (idx != 0)
-				{
-					Rect<int>& rc = m_diffInfos[idx - 1].rc;
-					if (static_cast<int>(bx) < rc.left)
-						rc.left = bx;
-					else if (static_cast<int>(bx + 1) > rc.right)
-						rc.right = bx + 1;
-					if (static_cast<int>(by) < rc.top)
-						rc.top = by;
-					else if (static_cast<int>(by + 1) > rc.bottom)
-						rc.bottom = by + 1;
-				}
-			}
-		}
-		return diffCount;
-	}
-
-	int MarkDiffIndex3way(const DiffBlocks& diff01, const DiffBlocks& diff21, const DiffBlocks& diff02, DiffBlocks& diff3)
-	{
-		int diffCount = MarkDiffIndex(diff3);
-		std::vector<DiffStat> counter(m_diffInfos.size());
-		for (unsigned by = 0; by < diff3.height(); ++by)
-		{
-			for (unsigned bx = 0; bx < diff3.width(); ++bx)
-			{
-				int diffIndex = diff3(bx, by);
-				if (diffIndex == 0)
-					continue;
-				--diffIndex;
-				if (diff21(bx, by) == 0)
-					++counter[diffIndex].d1;
-				else if (diff02(bx, by) == 0)
-					++counter[diffIndex].d2;
-				else if (diff01(bx, by) == 0)
-					++counter[diffIndex].d3;
-				else
-					++counter[diffIndex].detc;
-			}
-		}
-		
-		for (size_t i = 0; i < m_diffInfos.size(); ++i)
-		{
-			int op;
-			if (counter[i].d1 != 0 && counter[i].d2 == 0 && counter[i].d3 == 0 && counter[i].detc == 0)
-				op = OP_1STONLY;
-			else if (counter[i].d1 == 0 && counter[i].d2 != 0 && counter[i].d3 == 0 && counter[i].detc == 0)
-				op = OP_2NDONLY;
-			else if (counter[i].d1 == 0 && counter[i].d2 == 0 && counter[i].d3 != 0 && counter[i].detc == 0)
-				op = OP_3RDONLY;
-			else
-				op = OP_DIFF;
-			m_diffInfos[i].op = op;
-		}
-		return diffCount;
-	}
-
-	void Make3WayDiff(const DiffBlocks& diff01, const DiffBlocks& diff21, DiffBlocks& diff3)
-	{
-		diff3 = diff01;
-		for (unsigned bx = 0; bx < diff3.width(); ++bx)
-		{
-			for (unsigned by = 0; by < diff3.height(); ++by)
-			{
-				if (diff21(bx, by) != 0)
-					diff3(bx, by) = -1;
-			}
-		}
-	}
-
-	inline Image::Color GetDiffColorFromPosition(int pane, int x, int y, Image::Color diffColor, Image::Color diffDeletedColor)
-	{
-		x -= m_offset[pane].x;
-		y -= m_offset[pane].y;
-
-		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_NONE || 
-			m_lineDiffInfos.size() == 0 ||
-			x < 0 || x >= static_cast<int>(m_imgPreprocessed[pane].width()) ||
-			y < 0 || y >= static_cast<int>(m_imgPreprocessed[pane].height()))
-			return diffColor;
-
-		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_VERTICAL)
-		{
-			for (auto& lineDiff: m_lineDiffInfos)
-			{
-				if (lineDiff.dbegin <= y && y <= lineDiff.dendmax)
-					return diffDeletedColor;
-			}
-		}
-		else
-		{
-			for (auto& lineDiff : m_lineDiffInfos)
-			{
-				if (lineDiff.dbegin <= x && x <= lineDiff.dendmax)
-					return diffDeletedColor;
-			}
-		}
-		return diffColor;
-	}
-
-	void MarkDiff(int pane, const DiffBlocks& diff)
-	{
-		const unsigned w = m_imgDiff[pane].width();
-		const unsigned h = m_imgDiff[pane].height();
-
-		for (unsigned by = 0; by < diff.height(); ++by)
-		{
-			for (unsigned bx = 0; bx < diff.width(); ++bx)
-			{
-				int diffIndex = diff(bx, by);
-				if (diffIndex != 0 && (
-					(pane == 0 && m_diffInfos[diffIndex - 1].op != OP_3RDONLY) ||
-					(pane == 1) ||
-					(pane == 2 && m_diffInfos[diffIndex - 1].op != OP_1STONLY)
-					))
-				{
-					Image::Color color = (diffIndex - 1 == m_currentDiffIndex) ? m_selDiffColor : m_diffColor;
-					Image::Color colorDeleted = (diffIndex - 1 == m_currentDiffIndex) ? m_selDiffDeletedColor : m_diffDeletedColor;
-					unsigned bsy = (h - by * m_diffBlockSize < m_diffBlockSize) ? (h - by * m_diffBlockSize) : m_diffBlockSize;
-					for (unsigned i = 0; i < bsy; ++i)
-					{
-						unsigned y = by * m_diffBlockSize + i;
-						unsigned char *scanline = m_imgDiff[pane].scanLine(y);
-						unsigned bsx = (w - bx * m_diffBlockSize < m_diffBlockSize) ? (w - bx * m_diffBlockSize) : m_diffBlockSize;
-						for (unsigned j = 0; j < bsx; ++j)
-						{
-							unsigned x = bx * m_diffBlockSize + j;
-							if (scanline[x * 4 + 3] != 0)
-							{
-								scanline[x * 4 + 0] = static_cast<unsigned char>(scanline[x * 4 + 0] * (1 - m_diffColorAlpha) + Image::valueB(color) * m_diffColorAlpha);
-								scanline[x * 4 + 1] = static_cast<unsigned char>(scanline[x * 4 + 1] * (1 - m_diffColorAlpha) + Image::valueG(color) * m_diffColorAlpha);
-								scanline[x * 4 + 2] = static_cast<unsigned char>(scanline[x * 4 + 2] * (1 - m_diffColorAlpha) + Image::valueR(color) * m_diffColorAlpha);
-							}
-							else
-							{
-								Image::Color dcolor = GetDiffColorFromPosition(pane, x, y, color, colorDeleted);
-								scanline[x * 4 + 0] = Image::valueB(dcolor);
-								scanline[x * 4 + 1] = Image::valueG(dcolor);
-								scanline[x * 4 + 2] = Image::valueR(dcolor);
-								scanline[x * 4 + 3] = static_cast<unsigned char>(0xff * m_diffColorAlpha);
-							}
-						}
-					}
-				}
-			}
-		}
-	}
-
-	void WipeEffect()
-	{
-		const unsigned w = m_imgDiff[0].width();
-		const unsigned h = m_imgDiff[0].height();
-
-		if (m_wipePosition <= 0)
-			m_wipePosition = 0;
-
-		if (m_wipeMode == WIPE_VERTICAL)
-		{
-			if (m_wipePosition >= h)
-				m_wipePosition = h;
-			if (m_wipePosition_old == INT_MAX)
-				m_wipePosition_old = h;
-			const size_t lineBytes = w * 4;
-			std::vector<unsigned char> tmp(lineBytes);
-			if (m_wipePosition <= m_wipePosition_old)
-			{
-				for (unsigned y = m_wipePosition; y < m_wipePosition_old; ++y)
-				{
-					for (int pane = 0; pane < m_nImages - 1; ++pane)
-					{
-						unsigned char* scanline = m_imgDiff[pane].scanLine(y);
-						unsigned char* scanline2 = m_imgDiff[pane + 1].scanLine(y);
-						memcpy(tmp.data(), scanline, lineBytes);
-						memcpy(scanline, scanline2, lineBytes);
-						memcpy(scanline2, tmp.data(), lineBytes);
-					}
-				}
-			}
-			else
-			{
-				for (unsigned y = m_wipePosition_old; y < m_wipePosition; ++y)
-				{
-					for (int pane = m_nImages - 1; pane > 0; --pane)
-					{
-						unsigned char* scanline = m_imgDiff[pane].scanLine(y);
-						unsigned char* scanline2 = m_imgDiff[pane - 1].scanLine(y);
-						memcpy(tmp.data(), scanline, lineBytes);
-						memcpy(scanline, scanline2, lineBytes);
-						memcpy(scanline2, tmp.data(), lineBytes);
-					}
-				}
-			}
-		}
-		else if (m_wipeMode == WIPE_HORIZONTAL)
-		{
-			if (m_wipePosition >= w)
-				m_wipePosition = w;
-			if (m_wipePosition_old == INT_MAX)
-				m_wipePosition_old = w;
-			
-			const size_t pixelBytes = 4;
-			unsigned char tmp[4];
-			
-			for (unsigned y = 0; y < h; ++y)
-			{
-				for (int pane = 0; pane < m_nImages - 1; ++pane)
-				{
-					unsigned char* scanline;
-					unsigned char* scanline2;
-					if (m_wipePosition <= m_wipePosition_old)
-					{
-						scanline = m_imgDiff[pane].scanLine(y);
-						scanline2 = m_imgDiff[pane + 1].scanLine(y);
-						for (unsigned x = m_wipePosition; x < m_wipePosition_old; ++x)
-						{
-							memcpy(tmp, scanline + x * pixelBytes, pixelBytes);
-							memcpy(scanline + x * pixelBytes, scanline2 + x * pixelBytes, pixelBytes);
-							memcpy(scanline2 + x * pixelBytes, tmp, pixelBytes);
-						}
-					}
-					else
-					{
-						scanline = m_imgDiff[m_nImages - 2 - pane].scanLine(y);
-						scanline2 = m_imgDiff[m_nImages - 1 - pane].scanLine(y);
-						for (unsigned x = m_wipePosition_old; x < m_wipePosition; ++x)
-						{
-							memcpy(tmp, scanline + x * pixelBytes, pixelBytes);
-							memcpy(scanline + x * pixelBytes, scanline2 + x * pixelBytes, pixelBytes);
-							memcpy(scanline2 + x * pixelBytes, tmp, pixelBytes);
-						}
-					}
-				}
-			}
-		}
-		m_wipePosition_old = m_wipePosition;
-	}
-
-	void CopyPreprocessedImageToDiffImage(int dst)
-	{
-		unsigned w = m_imgPreprocessed[dst].width();
-		unsigned h = m_imgPreprocessed[dst].height();
-		unsigned offset_x = m_offset[dst].x;
-		for (unsigned y = 0; y < h; ++y)
-		{
-			const unsigned char *scanline_src = m_imgPreprocessed[dst].scanLine(y);
-			unsigned char *scanline_dst = m_imgDiff[dst].scanLine(y + m_offset[dst].y);
-			for (unsigned x = 0; x < w; ++x)
-			{
-				scanline_dst[(x + offset_x) * 4 + 0] = scanline_src[x * 4 + 0];
-				scanline_dst[(x + offset_x) * 4 + 1] = scanline_src[x * 4 + 1];
-				scanline_dst[(x + offset_x) * 4 + 2] = scanline_src[x * 4 + 2];
-				scanline_dst[(x + offset_x) * 4 + 3] = scanline_src[x * 4 + 3];
-			}
-		}	
-	}
-
-	void XorImages2(int src, int dst)
-	{
-		unsigned w = m_imgPreprocessed[src].width();
-		unsigned h = m_imgPreprocessed[src].height();
-		unsigned offset_x = m_offset[src].x;
-		for (unsigned y = 0; y < h; ++y)
-		{
-			const unsigned char *scanline_src = m_imgPreprocessed[src].scanLine(y);
-			unsigned char *scanline_dst = m_imgDiff[dst].scanLine(y + m_offset[src].y);
-			for (unsigned x = 0; x < w; ++x)
-			{
-				scanline_dst[(x + offset_x) * 4 + 0] ^= scanline_src[x * 4 + 0];
-				scanline_dst[(x + offset_x) * 4 + 1] ^= scanline_src[x * 4 + 1];
-				scanline_dst[(x + offset_x) * 4 + 2] ^= scanline_src[x * 4 + 2];
-			}
-		}	
-	}
-
-	void AlphaBlendImages2(int src, int dst)
-	{
-		unsigned w = m_imgPreprocessed[src].width();
-		unsigned h = m_imgPreprocessed[src].height();
-		unsigned offset_x = m_offset[src].x;
-		double overlayAlpha = m_overlayAlpha;
-		if (m_overlayMode == OVERLAY_ALPHABLEND_ANIM)
-		{
-			auto now = std::chrono::system_clock::now();
-			auto tse = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-			double t = static_cast<double>(tse.count() % m_overlayAnimationInterval);
-			if (t < m_overlayAnimationInterval * 2 / 10)
-				overlayAlpha = t / (m_overlayAnimationInterval * 2 / 10);
-			else if (t < m_overlayAnimationInterval * 5 / 10)
-				overlayAlpha = 1.0;
-			else if (t < m_overlayAnimationInterval * 7 / 10)
-				overlayAlpha = ((m_overlayAnimationInterval * 2 / 10) - (t - (m_overlayAnimationInterval * 5 / 10)))
-				              / (m_overlayAnimationInterval * 2 / 10);
-			else
-				overlayAlpha = 0.0;
-		}
-		for (unsigned y = 0; y < h; ++y)
-		{
-			const unsigned char *scanline_src = m_imgPreprocessed[src].scanLine(y);
-			unsigned char *scanline_dst = m_imgDiff[dst].scanLine(y + m_offset[src].y);
-			for (unsigned x = 0; x < w; ++x)
-			{
-				scanline_dst[(x + offset_x) * 4 + 0] = static_cast<unsigned char>(scanline_dst[(x + offset_x) * 4 + 0] * (1 - overlayAlpha) + scanline_src[x * 4 + 0] * overlayAlpha);
-				scanline_dst[(x + offset_x) * 4 + 1] = static_cast<unsigned char>(scanline_dst[(x + offset_x) * 4 + 1] * (1 - overlayAlpha) + scanline_src[x * 4 + 1] * overlayAlpha);
-				scanline_dst[(x + offset_x) * 4 + 2] = static_cast<unsigned char>(scanline_dst[(x + offset_x) * 4 + 2] * (1 - overlayAlpha) + scanline_src[x * 4 + 2] * overlayAlpha);
-				scanline_dst[(x + offset_x) * 4 + 3] = static_cast<unsigned char>(scanline_dst[(x + offset_x) * 4 + 3] * (1 - overlayAlpha) + scanline_src[x * 4 + 3] * overlayAlpha);
-			}
-		}	
-	}
-
-	void CopyImageWithGhostLine(const std::vector<LineDiffInfo>& lineDiffInfos, int npanes, Image src[], Image dst[])
-	{
-		unsigned nlines;
-		if (lineDiffInfos.size() == 0)
-		{
-			nlines = src[0].height();
-		}
-		else
-		{
-			const LineDiffInfo& lastLineDiff = lineDiffInfos.back();
-			nlines = (lastLineDiff.dendmax + 1) + src[0].height() - (lastLineDiff.end[0] + 1);
-		}
-
-		int ydst = 0;
-		for (int pane = 0; pane < npanes; ++pane)
-			dst[pane].setSize(src[pane].width(), nlines);
-		for (size_t i = 0; i < lineDiffInfos.size(); ++i)
-		{
-			const LineDiffInfo& lineDiffInfo = lineDiffInfos[i];
-
-			for (int pane = 0; pane < npanes; ++pane)
-			{
-				int orgydst = ydst;
-				for (int ysrc = (i > 0) ? (lineDiffInfos[i - 1].end[pane] + 1) : 0; ysrc < lineDiffInfo.begin[pane]; ++ysrc)
-					memcpy(dst[pane].scanLine(ydst++), src[pane].scanLine(ysrc), src[pane].width() * 4);
-				ydst = orgydst;
-			}
-
-			ydst = lineDiffInfo.dbegin;
-			for (int pane = 0; pane < npanes; ++pane)
-			{
-				int orgydst = ydst;
-				for (int ysrc = lineDiffInfo.begin[pane]; ysrc <= lineDiffInfo.end[pane]; ++ysrc)
-					memcpy(dst[pane].scanLine(ydst++), src[pane].scanLine(ysrc), src[pane].width() * 4);
-				ydst = orgydst;
-			}
-			ydst = lineDiffInfo.dendmax + 1;
-		}
-
-		for (int pane = 0; pane < npanes; ++pane)
-		{
-			int orgydst = ydst;
-			for (int ysrc = (lineDiffInfos.size() > 0) ? (lineDiffInfos[lineDiffInfos.size() - 1].end[pane] + 1) : 0;
-				ysrc < static_cast<int>(src[pane].height()); ++ysrc)
-				memcpy(dst[pane].scanLine(ydst++), src[pane].scanLine(ysrc), src[pane].width() * 4);
-			ydst = orgydst;
-		}
-	}
-
-	std::vector<LineDiffInfo> MakeLineDiff(const Image& img1, const Image& img2)
-	{
-		DataForDiff data1(img1, m_colorDistanceThreshold);
-		DataForDiff data2(img2, m_colorDistanceThreshold);
-		Diff<DataForDiff> diff(data1, data2);
-		std::vector<char> edscript;
-		std::vector<LineDiffInfo> lineDiffInfosTmp;
-		std::vector<LineDiffInfo> lineDiffInfos;
-
-		diff.diff(static_cast<Diff<DataForDiff>::Algorithm>(m_diffAlgorithm), edscript);
-
-		int i = 0, j = 0;
-		for (auto ed : edscript)
-		{
-			switch (ed)
-			{
-			case '-':
-				lineDiffInfosTmp.emplace_back(i, i, j, j - 1);
-				++i;
-				break;
-			case '+':
-				lineDiffInfosTmp.emplace_back(i, i - 1, j, j);
-				++j;
-				break;
-			case '!':
-				lineDiffInfosTmp.emplace_back(i, i, j, j);
-				++i;
-				++j;
-				break;
-			default:
-				++i;
-				++j;
-				break;
-			}
-		}
-
-		lineDiffInfos.clear();
-		for (size_t i = 0; i < lineDiffInfosTmp.size(); ++i)
-		{
-			bool skipIt = false;
-			// combine it with next ?
-			if (i + 1 < (int)lineDiffInfosTmp.size())
-			{
-				if (lineDiffInfosTmp[i].end[0] + 1 == lineDiffInfosTmp[i + 1].begin[0]
-					&& lineDiffInfosTmp[i].end[1] + 1 == lineDiffInfosTmp[i + 1].begin[1])
-				{
-					// diff[i] and diff[i+1] are contiguous
-					// so combine them into diff[i+1] and ignore diff[i]
-					lineDiffInfosTmp[i + 1].begin[0] = lineDiffInfosTmp[i].begin[0];
-					lineDiffInfosTmp[i + 1].begin[1] = lineDiffInfosTmp[i].begin[1];
-					skipIt = true;
-				}
-			}
-			if (!skipIt)
-			{
-				// Should never have a pair where both are missing
-				assert(lineDiffInfosTmp[i].begin[0] >= 0 || lineDiffInfosTmp[i].begin[1] >= 0);
-
-				// Store the diff[i] in the caller list (m_pDiffs)
-				lineDiffInfos.push_back(lineDiffInfosTmp[i]);
-			}
-		}
-
-		return lineDiffInfos;
-	}
-
-	unsigned PrimeLineDiffInfos(std::vector<LineDiffInfo>& lineDiffInfos, int npanes, unsigned height0)
-	{
-		unsigned dlines = 0;
-		for (size_t i = 0; i < lineDiffInfos.size(); ++i)
-		{
-			dlines += lineDiffInfos[i].begin[0] - ((i > 0) ? (lineDiffInfos[i - 1].end[0] + 1) : 0);
-
-			LineDiffInfo& lineDiffInfo = lineDiffInfos[i];
-			lineDiffInfo.dbegin = dlines;
-			lineDiffInfo.dendmax = 0;
-			for (int pane = 0; pane < npanes; ++pane)
-			{
-				lineDiffInfo.dend[pane] = lineDiffInfo.dbegin + lineDiffInfo.end[pane] - lineDiffInfo.begin[pane];
-				if (lineDiffInfo.dendmax < lineDiffInfo.dbegin + lineDiffInfo.end[pane] - lineDiffInfo.begin[pane])
-					lineDiffInfo.dendmax = lineDiffInfo.dbegin + lineDiffInfo.end[pane] - lineDiffInfo.begin[pane];
-			}
-			dlines = lineDiffInfo.dendmax + 1;
-		}
-		dlines += height0 - (lineDiffInfos.size() > 0 ? lineDiffInfos[lineDiffInfos.size() - 1].end[0] + 1 : 0);
-		return dlines;
-	}
-
-	class TemporaryTransformation
-	{
-	public:
-		TemporaryTransformation(CImgDiffBuffer& buffer)
-			: m_buffer(buffer)
-		{
-			m_buffer.TransformImages(false);
-		}
-
-		~TemporaryTransformation()
-		{
-			m_buffer.TransformImages(true);
-		}
-	private:
-		CImgDiffBuffer& m_buffer;
-	};
-
-	void TransformImages(bool reverse)
-	{
-		m_temporarilyTransformed = !reverse;
-		for (int pane = 0; pane < m_nImages; ++pane)
-		{
-			if (!reverse)
-			{
-				if (m_horizontalFlip[pane])
-					m_imgOrig32[pane].flipHorizontal();
-				if (m_verticalFlip[pane])
-					m_imgOrig32[pane].flipVertical();
-				if (m_angle[pane])
-					m_imgOrig32[pane].rotate(m_angle[pane]);
-			}
-			else
-			{
-				if (m_angle[pane])
-					m_imgOrig32[pane].rotate(-m_angle[pane]);
-				if (m_horizontalFlip[pane])
-					m_imgOrig32[pane].flipHorizontal();
-				if (m_verticalFlip[pane])
-					m_imgOrig32[pane].flipVertical();
-			}
-		}
-	}
-
-	void PreprocessImages()
-	{
-		auto compfunc02 = [&](const LineDiffInfo & wd3) {
-			unsigned wlen0 = wd3.end[0] + 1 - wd3.begin[0];
-			unsigned wlen2 = wd3.end[2] + 1 - wd3.begin[2];
-			if (wlen0 != wlen2)
-				return false;
-			for (unsigned i = 0; i < wlen0; ++i)
-			{
-				if (!alineEquals(
-					m_imgOrig32[0], m_imgOrig32[2],
-					wd3.begin[0] + i, wd3.begin[2] + i,
-					m_colorDistanceThreshold))
-					return false;
-			}
-			return true;
-		};
-		
-		TemporaryTransformation tmp(*this);
-
-		std::vector<LineDiffInfo> lineDiffInfos10, lineDiffInfos12;
-		switch (m_insertionDeletionDetectionMode)
-		{
-		case INSERTION_DELETION_DETECTION_VERTICAL:
-		{
-			if (m_nImages == 2)
-				 m_lineDiffInfos = MakeLineDiff(m_imgOrig32[0], m_imgOrig32[1]);
-			else
-			{
-				lineDiffInfos10 = MakeLineDiff(m_imgOrig32[1], m_imgOrig32[0]);
-				lineDiffInfos12 = MakeLineDiff(m_imgOrig32[1], m_imgOrig32[2]);
-				m_lineDiffInfos = ::Make3WayLineDiff(lineDiffInfos10, lineDiffInfos12, compfunc02);
-			}
-			PrimeLineDiffInfos(m_lineDiffInfos, m_nImages, m_imgOrig32[0].height());
-			CopyImageWithGhostLine(m_lineDiffInfos, m_nImages, m_imgOrig32, m_imgPreprocessed);
-			break;
-		}
-		case INSERTION_DELETION_DETECTION_HORIZONTAL:
-		{
-			Image imgTransposed[3] = { m_imgOrig32[0], m_imgOrig32[1], m_imgOrig32[2] };
-			for (int pane = 0; pane < m_nImages; ++pane)
-				imgTransposed[pane].rotate(-90);
-			if (m_nImages == 2)
-				m_lineDiffInfos = MakeLineDiff(imgTransposed[0], imgTransposed[1]);
-			else
-			{
-				lineDiffInfos10 = MakeLineDiff(imgTransposed[1], imgTransposed[0]);
-				lineDiffInfos12 = MakeLineDiff(imgTransposed[1], imgTransposed[2]);
-				m_lineDiffInfos = ::Make3WayLineDiff(lineDiffInfos10, lineDiffInfos12, compfunc02);
-			}
-			PrimeLineDiffInfos(m_lineDiffInfos, m_nImages, m_imgOrig32[0].height());
-			CopyImageWithGhostLine(m_lineDiffInfos, m_nImages, imgTransposed, m_imgPreprocessed);
-			for (int pane = 0; pane < m_nImages; ++pane)
-				m_imgPreprocessed[pane].rotate(90);
-			break;
-		}
-		default:
-			m_lineDiffInfos.clear();
-			for (int i = 0; i < m_nImages; ++i)
-				m_imgPreprocessed[i] = m_imgOrig32[i];
-			break;
-		}
-	}
-
-	int m_nImages;
-	MultiPageImages m_imgOrigMultiPage[3];
-	Point<unsigned> m_offset[3];
-	Image m_imgOrig[3];
-	Image m_imgOrig32[3];
-	Image m_imgPreprocessed[3];
-	Image m_imgDiff[3];
-	Image m_imgDiffMap;
-	ImgConverter m_imgConverter[3];
-	std::wstring m_filename[3];
-	bool m_showDifferences;
-	bool m_blinkDifferences;
-	float m_vectorImageZoomRatio;
-	INSERTION_DELETION_DETECTION_MODE m_insertionDeletionDetectionMode;
-	OVERLAY_MODE m_overlayMode;
-	double m_overlayAlpha;
-	WIPE_MODE m_wipeMode;
-	int m_wipePosition;
-	int m_wipePosition_old;
-	unsigned m_diffBlockSize;
-	Image::Color m_selDiffColor;
-	Image::Color m_selDiffDeletedColor;
-	Image::Color m_diffColor;
-	Image::Color m_diffDeletedColor;
-	double m_diffColorAlpha;
-	double m_colorDistanceThreshold;
-	float m_angle[3];
-	bool m_horizontalFlip[3];
-	bool m_verticalFlip[3];
-	int m_currentPage[3];
-	int m_currentDiffIndex;
-	int m_diffCount;
-	DiffBlocks m_diff, m_diff01, m_diff21, m_diff02;
-	std::vector<DiffInfo> m_diffInfos;
-	std::vector<LineDiffInfo> m_lineDiffInfos;
-	bool m_temporarilyTransformed;
-	DIFF_ALGORITHM m_diffAlgorithm;
-	int m_blinkInterval;
-	int m_overlayAnimationInterval;
-	int m_lastErrorCode;
-	bool m_imgDiffIsTransparent[3]{};
-};
+/////////////////////////////////////////////////////////////////////////////
+//    License (GPLv2+):
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "image.hpp"
+#include "ImgConverter.hpp"
+#include "Diff.hpp"
+#include "ImgDiffKernels.hpp"
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <cmath>
+#include <cassert>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+enum OP_TYPE
+{
+	OP_NONE = 0, OP_1STONLY, OP_2NDONLY, OP_3RDONLY, OP_DIFF, OP_TRIVIAL
+};
+
+template<class T> struct Point
+{
+	Point(): x(0), y(0) {}
+	Point(T x, T y): x(x), y(y) {}
+	T x, y;
+};
+
+template<class T> struct Size
+{
+	Size(T cx, T cy): cx(cx), cy(cy) {}
+	T cx, cy;
+};
+
+template<class T> struct Rect
+{
+	Rect(T left, T top, T right, T bottom): left(left), top(top), right(right), bottom(bottom) {}
+	T left, top, right, bottom;
+};
+
+template <class T> struct Array2D
+{
+	Array2D() : m_width(0), m_height(0), m_data(NULL)
+	{
+	}
+
+	Array2D(size_t width, size_t height) : m_width(width), m_height(height), m_data(new T[width * height])
+	{
+		memset(m_data, 0, m_width * m_height * sizeof(T));
+	}
+
+	Array2D(const Array2D& other) : m_width(other.m_width), m_height(other.m_height), m_data(new T[other.m_width * other.m_height])
+	{
+		memcpy(m_data, other.m_data, m_width * m_height * sizeof(T));
+	}
+
+	Array2D& operator=(const Array2D& other)
+	{
+		if (this != &other)
+		{
+			delete[] m_data;
+			m_width  = other.m_width;
+			m_height = other.m_height;
+			m_data = new T[other.m_width * other.m_height];
+			memcpy(m_data, other.m_data, m_width * m_height * sizeof(T));
+		}
+		return *this;
+	}
+
+	~Array2D()
+	{
+		delete[] m_data;
+	}
+
+	void resize(size_t width, size_t height)
+	{
+		delete[] m_data;
+		m_data = new T[width * height];
+		m_width  = width;
+		m_height = height;
+		memset(m_data, 0, sizeof(T) * width * height);
+	}
+
+	T& operator()(int x, int y)
+	{
+		return m_data[y * m_width + x];
+	}
+
+	const T& operator()(int x, int y) const
+	{
+		return m_data[y * m_width + x];
+	}
+
+	void clear()
+	{
+		delete[] m_data;
+		m_data = NULL;
+		m_width = 0;
+		m_height = 0;
+	}
+
+	size_t height() const
+	{
+		return m_height;
+	}
+
+	size_t width() const
+	{
+		return m_width;
+	}
+
+	size_t m_width, m_height;
+	T* m_data;
+};
+
+// 2D array of mostly zero values that only keeps the runs of equal non-zero values of each row,
+// so that its size depends on the amount of differences rather than on the image size
+template <class T> struct RunLengthArray2D
+{
+	struct Run
+	{
+		Run(unsigned x, unsigned length, T value) : x(x), length(length), value(value) {}
+		unsigned x, length;
+		T value;
+	};
+	typedef std::vector<Run> Row;
+
+	RunLengthArray2D() : m_width(0), m_height(0)
+	{
+	}
+
+	void resize(size_t width, size_t height)
+	{
+		m_rows.clear();
+		m_rows.resize(height);
+		m_width  = width;
+		m_height = height;
+	}
+
+	T operator()(int x, int y) const
+	{
+		const Row& row = m_rows[y];
+		auto it = std::upper_bound(row.begin(), row.end(), static_cast<unsigned>(x),
+			[](unsigned x, const Run& run) { return x < run.x; });
+		if (it == row.begin())
+			return T();
+		--it;
+		return (static_cast<unsigned>(x) < it->x + it->length) ? it->value : T();
+	}
+
+	const Row& row(size_t y) const
+	{
+		return m_rows[y];
+	}
+
+	Row& row(size_t y)
+	{
+		return m_rows[y];
+	}
+
+	// Replaces row y with the runs of the width() values
+	void setRow(size_t y, const T *values)
+	{
+		Row& row = m_rows[y];
+		row.clear();
+		for (size_t x = 0; x < m_width; )
+		{
+			if (values[x] == T())
+			{
+				++x;
+				continue;
+			}
+			size_t end = x + 1;
+			while (end < m_width && values[end] == values[x])
+				++end;
+			row.push_back(Run(static_cast<unsigned>(x), static_cast<unsigned>(end - x), values[x]));
+			x = end;
+		}
+	}
+
+	// Expands row y to width() values
+	void getRow(size_t y, T *values) const
+	{
+		std::fill(values, values + m_width, T());
+		for (const Run& run : m_rows[y])
+			std::fill(values + run.x, values + run.x + run.length, run.value);
+	}
+
+	void clear()
+	{
+		m_rows.clear();
+		m_width = 0;
+		m_height = 0;
+	}
+
+	size_t height() const
+	{
+		return m_height;
+	}
+
+	size_t width() const
+	{
+		return m_width;
+	}
+
+	// Replaces row y with runs of value for the bits set in mask
+	void setRowFromMask(size_t y, const uint64_t *mask, T value)
+	{
+		Row& row = m_rows[y];
+		row.clear();
+		size_t x = 0;
+		while (x < m_width)
+		{
+			const uint64_t word = mask[x / 64] >> (x % 64);
+			if (word == 0)
+			{
+				x = (x / 64 + 1) * 64;
+				continue;
+			}
+			x += ImgDiffKernels::CountTrailingZeros64(word);
+			size_t end = x;
+			while (end < m_width)
+			{
+				const unsigned rest = 64 - end % 64;
+				const uint64_t zeros = ~(mask[end / 64] >> (end % 64));
+				const unsigned ones = zeros ? (std::min)(ImgDiffKernels::CountTrailingZeros64(zeros), rest) : rest;
+				end += ones;
+				if (ones < rest)
+					break;
+			}
+			end = (std::min)(end, m_width);
+			if (x < end)
+				row.push_back(Run(static_cast<unsigned>(x), static_cast<unsigned>(end - x), value));
+			x = end;
+		}
+	}
+
+	size_t m_width, m_height;
+	std::vector<Row> m_rows;
+};
+
+// 2D array of bits packed into 64-bit words. Every row starts at a word boundary
+// so that rows can be written concurrently and combined word by word.
+struct BitArray2D
+{
+	BitArray2D() : m_width(0), m_height(0), m_wordsPerRow(0)
+	{
+	}
+
+	void resize(size_t width, size_t height)
+	{
+		m_wordsPerRow = (width + 63) / 64;
+		m_words.assign(m_wordsPerRow * height, 0);
+		m_width  = width;
+		m_height = height;
+	}
+
+	bool operator()(int x, int y) const
+	{
+		return (row(y)[x / 64] >> (x % 64)) & 1;
+	}
+
+	const uint64_t *row(size_t y) const
+	{
+		return m_words.data() + y * m_wordsPerRow;
+	}
+
+	uint64_t *row(size_t y)
+	{
+		return m_words.data() + y * m_wordsPerRow;
+	}
+
+	// Replaces row y with one bit per value, set for the non-zero values
+	template <class T> void setRow(size_t y, const T *values)
+	{
+		uint64_t *words = row(y);
+		std::fill(words, words + m_wordsPerRow, 0);
+		for (size_t x = 0; x < m_width; ++x)
+		{
+			if (values[x] != T())
+				words[x / 64] |= uint64_t(1) << (x % 64);
+		}
+	}
+
+	void clear()
+	{
+		m_words.clear();
+		m_width = 0;
+		m_height = 0;
+		m_wordsPerRow = 0;
+	}
+
+	size_t height() const
+	{
+		return m_height;
+	}
+
+	size_t width() const
+	{
+		return m_width;
+	}
+
+	size_t wordsPerRow() const
+	{
+		return m_wordsPerRow;
+	}
+
+	size_t m_width, m_height, m_wordsPerRow;
+	std::vector<uint64_t> m_words;
+};
+
+struct DiffInfo
+{
+	DiffInfo(int op, int x, int y) : op(op), rc(x, y, x + 1, y + 1) {}
+	int op;
+	Rect<int> rc;
+};
+
+struct LineDiffInfo
+{
+	LineDiffInfo(int s1 = 0, int e1 = 0, int s2 = 0, int e2 = 0, int s3 = 0, int e3 = 0) :
+		begin{ s1, s2, s3 }, end{ e1, e2, e3 },
+		dbegin(0), dend{ -1, -1, -1 }, dendmax(-1), op(OP_DIFF) {}
+
+	LineDiffInfo(const LineDiffInfo& src) :
+		begin{ src.begin[0], src.begin[1], src.begin[2] },
+		end{ src.end[0], src.end[1], src.end[2] }, 
+		dbegin(src.dbegin),
+		dend{ src.dend[0], src.dend[1], src.dend[2] }, 
+		dendmax(src.dendmax), op(src.op)
+	{}
+
+	int begin[3];
+	int end[3];
+	int dbegin;
+	int dend[3];
+	int dendmax;
+	int op;
+};
+
+struct DiffStat { int d1, d2, d3, detc; };
+
+namespace
+{
+	int GetColorDistance2(Image::Color c1, Image::Color c2)
+	{
+		int rdist = Image::valueR(c1) - Image::valueR(c2);
+		int gdist = Image::valueG(c1) - Image::valueG(c2);
+		int bdist = Image::valueB(c1) - Image::valueB(c2);
+		int adist = Image::valueA(c1) - Image::valueA(c2);
+		return rdist * rdist + gdist * gdist + bdist * bdist + adist * adist;
+	}
+
+	unsigned GetWorkerThreadCount(unsigned threadCount, unsigned count)
+	{
+		if (threadCount == 0)
+			threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+		return (std::min)(threadCount, count);
+	}
+
+	int FindRootLabel(std::vector<int>& parent, int label)
+	{
+		while (parent[label] != label)
+		{
+			parent[label] = parent[parent[label]];
+			label = parent[label];
+		}
+		return label;
+	}
+
+	// Links the root with the larger label to the one with the smaller label
+	void UnionLabels(std::vector<int>& parent, int label1, int label2)
+	{
+		label1 = FindRootLabel(parent, label1);
+		label2 = FindRootLabel(parent, label2);
+		if (label1 < label2)
+			parent[label2] = label1;
+		else if (label2 < label1)
+			parent[label1] = label2;
+	}
+
+	// Whether the calling thread is running iterations of a WorkerPool::ParallelFor
+	bool& InParallelFor()
+	{
+		static thread_local bool inParallelFor = false;
+		return inParallelFor;
+	}
+
+	/* Threads kept across calls to ParallelFor, so that compositing a frame or comparing does not
+	   create and join threads. They are started by the first ParallelFor that has work for them,
+	   so a pool that is never used costs no threads. The calling thread takes part too, so n
+	   threads run up to n + 1 iterations at once. A ParallelFor called from inside an iteration
+	   runs on its thread. */
+	class WorkerPool
+	{
+	public:
+		WorkerPool() : m_threadCount(0), m_started(false), m_job(nullptr), m_generation(0), m_busy(0), m_stop(false) {}
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		~WorkerPool() { Stop(); }
+
+		unsigned GetThreadCount() const { return m_threadCount; }
+
+		/* Uses up to threadCount threads besides the calling one. Threads already started for
+		   another count are stopped, and the next ParallelFor starts the new ones. */
+		void SetThreadCount(unsigned threadCount)
+		{
+			if (threadCount == m_threadCount)
+				return;
+			std::lock_guard<std::mutex> submitLock(m_submitMutex);
+			Stop();
+			m_threadCount = threadCount;
+		}
+
+		/* Calls func(i) for each i in [0, count). Each index is processed exactly once, so func
+		   must only write state owned by that index. The first exception func throws stops the
+		   loop and is rethrown once all the threads are done with it. */
+		template<typename Func>
+		void ParallelFor(unsigned count, Func func)
+		{
+			if (count == 0)
+				return;
+			if (count == 1 || m_threadCount == 0 || InParallelFor())
+			{
+				for (unsigned i = 0; i < count; ++i)
+					func(i);
+				return;
+			}
+			std::lock_guard<std::mutex> submitLock(m_submitMutex);
+			Start();
+			if (m_threads.empty())
+			{
+				for (unsigned i = 0; i < count; ++i)
+					func(i);
+				return;
+			}
+			Job job(count, &func, [](void *f, unsigned i) { (*static_cast<Func *>(f))(i); });
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_job = &job;
+				++m_generation;
+			}
+			m_wake.notify_all();
+			job.Run();
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_done.wait(lock, [this]() { return m_busy == 0; });
+				m_job = nullptr;
+			}
+			if (job.error)
+				std::rethrow_exception(job.error);
+		}
+
+	private:
+		struct Job
+		{
+			Job(unsigned count, void *func, void (*invoke)(void *, unsigned))
+				: count(count), func(func), invoke(invoke), next(0) {}
+
+			void Run()
+			{
+				InParallelFor() = true;
+				for (unsigned i = next++; i < count; i = next++)
+				{
+					try
+					{
+						invoke(func, i);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(errorMutex);
+						if (!error)
+							error = std::current_exception();
+						next = count;
+					}
+				}
+				InParallelFor() = false;
+			}
+
+			unsigned count;
+			void *func;
+			void (*invoke)(void *, unsigned);
+			std::atomic<unsigned> next;
+			std::mutex errorMutex;
+			std::exception_ptr error;
+		};
+
+		void Work()
+		{
+			unsigned generation = 0;
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (;;)
+			{
+				m_wake.wait(lock, [&]() { return m_stop || m_generation != generation; });
+				if (m_stop)
+					return;
+				generation = m_generation;
+				// the job is gone if the other threads finished it before this one woke up
+				Job *job = m_job;
+				if (!job)
+					continue;
+				++m_busy;
+				lock.unlock();
+				job->Run();
+				lock.lock();
+				if (--m_busy == 0)
+					m_done.notify_all();
+			}
+		}
+
+		// Starts the threads once. If the system cannot create all of them, the pool goes on
+		// with those it could.
+		void Start()
+		{
+			if (m_started)
+				return;
+			m_started = true;
+			try
+			{
+				m_threads.reserve(m_threadCount);
+				for (unsigned i = 0; i < m_threadCount; ++i)
+					m_threads.emplace_back([this]() { Work(); });
+			}
+			catch (const std::exception&)
+			{
+			}
+		}
+
+		void Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			for (auto& thread : m_threads)
+				thread.join();
+			m_threads.clear();
+			m_stop = false;
+			m_started = false;
+		}
+
+		unsigned m_threadCount;
+		bool m_started; // whether Start has run since the last Stop
+		std::vector<std::thread> m_threads;
+		std::mutex m_submitMutex; // one ParallelFor or SetThreadCount at a time
+		std::mutex m_mutex;       // guards the members below
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		Job *m_job;
+		unsigned m_generation;
+		unsigned m_busy; // threads other than the caller running m_job
+		bool m_stop;
+	};
+
+	/* diff3 algorithm. It is almost the same as GNU diff3's algorithm */
+	template<typename Element, typename Comp02Func>
+	std::vector<Element> Make3WayLineDiff(const std::vector<Element>& diff10, const std::vector<Element>& diff12,
+		Comp02Func cmpfunc)
+	{
+		std::vector<Element> diff3;
+
+		size_t diff10count = diff10.size();
+		size_t diff12count = diff12.size();
+
+		size_t diff10i = 0;
+		size_t diff12i = 0;
+		size_t diff3i = 0;
+
+		bool firstDiffBlockIsDiff12;
+
+		Element dr3, dr10, dr12, dr10first, dr10last, dr12first, dr12last;
+
+		int linelast0 = 0;
+		int linelast1 = 0;
+		int linelast2 = 0;
+
+		for (;;)
+		{
+			if (diff10i >= diff10count && diff12i >= diff12count)
+				break;
+
+			/*
+			 * merge overlapped diff blocks
+			 * diff10 is diff blocks between file1 and file0.
+			 * diff12 is diff blocks between file1 and file2.
+			 *
+			 *                      diff12
+			 *                 diff10            diff3
+			 *                 |~~~|             |~~~|
+			 * firstDiffBlock  |   |             |   |
+			 *                 |   | |~~~|       |   |
+			 *                 |___| |   |       |   |
+			 *                       |   |   ->  |   |
+			 *                 |~~~| |___|       |   |
+			 * lastDiffBlock   |   |             |   |
+			 *                 |___|             |___|
+			 */
+
+			if (diff10i >= diff10count && diff12i < diff12count)
+			{
+				dr12first = diff12.at(diff12i);
+				dr12last = dr12first;
+				firstDiffBlockIsDiff12 = true;
+			}
+			else if (diff10i < diff10count && diff12i >= diff12count)
+			{
+				dr10first = diff10.at(diff10i);
+				dr10last = dr10first;
+				firstDiffBlockIsDiff12 = false;
+			}
+			else
+			{
+				dr10first = diff10.at(diff10i);
+				dr12first = diff12.at(diff12i);
+				dr10last = dr10first;
+				dr12last = dr12first;
+				if (dr12first.begin[0] <= dr10first.begin[0])
+					firstDiffBlockIsDiff12 = true;
+				else
+					firstDiffBlockIsDiff12 = false;
+			}
+			bool lastDiffBlockIsDiff12 = firstDiffBlockIsDiff12;
+
+			size_t diff10itmp = diff10i;
+			size_t diff12itmp = diff12i;
+			for (;;)
+			{
+				if (diff10itmp >= diff10count || diff12itmp >= diff12count)
+					break;
+
+				dr10 = diff10.at(diff10itmp);
+				dr12 = diff12.at(diff12itmp);
+
+				if (dr10.end[0] == dr12.end[0])
+				{
+					diff10itmp++;
+					lastDiffBlockIsDiff12 = true;
+
+					dr10last = dr10;
+					dr12last = dr12;
+					break;
+				}
+
+				if (lastDiffBlockIsDiff12)
+				{
+					if ((std::max)(dr12.begin[0], dr12.end[0]) < dr10.begin[0])
+						break;
+				}
+				else
+				{
+					if ((std::max)(dr10.begin[0], dr10.end[0]) < dr12.begin[0])
+						break;
+				}
+
+				if (dr12.end[0] > dr10.end[0])
+				{
+					diff10itmp++;
+					lastDiffBlockIsDiff12 = true;
+				}
+				else
+				{
+					diff12itmp++;
+					lastDiffBlockIsDiff12 = false;
+				}
+
+				dr10last = dr10;
+				dr12last = dr12;
+			}
+
+			if (lastDiffBlockIsDiff12)
+				diff12itmp++;
+			else
+				diff10itmp++;
+
+			if (firstDiffBlockIsDiff12)
+			{
+				dr3.begin[1] = dr12first.begin[0];
+				dr3.begin[2] = dr12first.begin[1];
+				if (diff10itmp == diff10i)
+					dr3.begin[0] = dr3.begin[1] - linelast1 + linelast0;
+				else
+					dr3.begin[0] = dr3.begin[1] - dr10first.begin[0] + dr10first.begin[1];
+			}
+			else
+			{
+				dr3.begin[0] = dr10first.begin[1];
+				dr3.begin[1] = dr10first.begin[0];
+				if (diff12itmp == diff12i)
+					dr3.begin[2] = dr3.begin[1] - linelast1 + linelast2;
+				else
+					dr3.begin[2] = dr3.begin[1] - dr12first.begin[0] + dr12first.begin[1];
+			}
+
+			if (lastDiffBlockIsDiff12)
+			{
+				dr3.end[1] = dr12last.end[0];
+				dr3.end[2] = dr12last.end[1];
+				if (diff10itmp == diff10i)
+					dr3.end[0] = dr3.end[1] - linelast1 + linelast0;
+				else
+					dr3.end[0] = dr3.end[1] - dr10last.end[0] + dr10last.end[1];
+			}
+			else
+			{
+				dr3.end[0] = dr10last.end[1];
+				dr3.end[1] = dr10last.end[0];
+				if (diff12itmp == diff12i)
+					dr3.end[2] = dr3.end[1] - linelast1 + linelast2;
+				else
+					dr3.end[2] = dr3.end[1] - dr12last.end[0] + dr12last.end[1];
+			}
+
+			linelast0 = dr3.end[0] + 1;
+			linelast1 = dr3.end[1] + 1;
+			linelast2 = dr3.end[2] + 1;
+
+			if (diff10i == diff10itmp)
+				dr3.op = OP_3RDONLY;
+			else if (diff12i == diff12itmp)
+				dr3.op = OP_1STONLY;
+			else
+			{
+				if (!cmpfunc(dr3))
+					dr3.op = OP_DIFF;
+				else
+					dr3.op = OP_2NDONLY;
+			}
+
+			diff3.push_back(dr3);
+
+			diff3i++;
+			diff10i = diff10itmp;
+			diff12i = diff12itmp;
+		}
+
+		for (size_t i = 0; i < diff3i; i++)
+		{
+			Element& dr3r = diff3.at(i);
+			if (i < diff3i - 1)
+			{
+				Element& dr3next = diff3.at(i + 1);
+				for (int j = 0; j < 3; j++)
+				{
+					if (dr3r.end[j] >= dr3next.begin[j])
+						dr3r.end[j] = dr3next.begin[j] - 1;
+				}
+			}
+		}
+
+		return diff3;
+	}
+
+	bool alineEquals(const unsigned char* scanline1, unsigned width1,
+		const unsigned char* scanline2, unsigned width2,
+		int colorDistanceThreshold2, const ImgDiffKernels::ColorDistanceWeights& weights)
+	{
+		if (width1 != width2)
+			return false;
+		if (ImgDiffKernels::IsExactCompare(colorDistanceThreshold2, weights))
+			return (memcmp(scanline1, scanline2, width1 * 4) == 0);
+		return ImgDiffKernels::GetKernels().equalsThreshold(scanline1, scanline2, width1, colorDistanceThreshold2, weights);
+	}
+
+	bool alineEquals(const Image& img1, const Image& img2,
+		unsigned y1, unsigned y2, int colorDistanceThreshold2, const ImgDiffKernels::ColorDistanceWeights& weights)
+	{
+		return alineEquals(img1.scanLine(y1), img1.width(), img2.scanLine(y2), img2.width(), colorDistanceThreshold2, weights);
+	}
+
+	// Compares two columns of pixels, each pixel step bytes after the one above it. The pixels
+	// are gathered into short runs that the line kernels compare, so that a long column is
+	// read in a single pass and only as far as its first difference.
+	bool acolumnEquals(const unsigned char* top1, ptrdiff_t step1, unsigned height1,
+		const unsigned char* top2, ptrdiff_t step2, unsigned height2,
+		int colorDistanceThreshold2, const ImgDiffKernels::ColorDistanceWeights& weights)
+	{
+		if (height1 != height2)
+			return false;
+		enum { GATHER_PIXELS = 64 };
+		unsigned char run1[GATHER_PIXELS * 4], run2[GATHER_PIXELS * 4];
+		for (unsigned y = 0; y < height1; y += GATHER_PIXELS)
+		{
+			const unsigned count = (std::min)(height1 - y, static_cast<unsigned>(GATHER_PIXELS));
+			for (unsigned i = 0; i < count; ++i)
+			{
+				memcpy(&run1[i * 4], top1 + static_cast<ptrdiff_t>(y + i) * step1, 4);
+				memcpy(&run2[i * 4], top2 + static_cast<ptrdiff_t>(y + i) * step2, 4);
+			}
+			if (!alineEquals(run1, count, run2, count, colorDistanceThreshold2, weights))
+				return false;
+		}
+		return true;
+	}
+
+	bool acolumnEquals(const Image& img1, const Image& img2,
+		unsigned x1, unsigned x2, int colorDistanceThreshold2, const ImgDiffKernels::ColorDistanceWeights& weights)
+	{
+		const ptrdiff_t step1 = img1.height() > 1 ? img1.scanLine(1) - img1.scanLine(0) : 0;
+		const ptrdiff_t step2 = img2.height() > 1 ? img2.scanLine(1) - img2.scanLine(0) : 0;
+		return acolumnEquals(img1.scanLine(0) + x1 * 4, step1, img1.height(),
+			img2.scanLine(0) + x2 * 4, step2, img2.height(), colorDistanceThreshold2, weights);
+	}
+
+	// The quantization of the channels hashed for a color distance threshold, so that pixels
+	// within the threshold tend to get the same hash, or 0 for an exact compare
+	unsigned hashQuantum(double colorDistanceThreshold)
+	{
+		if (colorDistanceThreshold <= 0.0)
+			return 0;
+		const unsigned quantum = static_cast<unsigned>(sqrt((colorDistanceThreshold * colorDistanceThreshold) / 3.0)) * 2;
+		return quantum == 0 ? 1 : quantum;
+	}
+
+	// The bytes of a pixel that are hashed. Channels with zero weight never make lines different,
+	// so they must not affect the hash either.
+	uint32_t hashChannelMask(const ImgDiffKernels::ColorDistanceWeights& weights)
+	{
+		return (weights.b ? 0x000000ffu : 0) | (weights.g ? 0x0000ff00u : 0) |
+			(weights.r ? 0x00ff0000u : 0) | (weights.a ? 0xff000000u : 0);
+	}
+
+	// Folds a 64-bit line hash into the hash type of Diff<Data>
+	unsigned long foldHash(uint64_t ha)
+	{
+		return static_cast<unsigned long>(ha ^ (ha >> 32));
+	}
+}
+
+class DataForDiff
+{
+public:
+	DataForDiff(const Image& img, double colorDistanceThreshold, const ImgDiffKernels::ColorDistanceWeights& weights)
+		: m_img(img)
+		, m_colorDistanceThreshold2(ImgDiffKernels::ColorDistanceThreshold2(colorDistanceThreshold))
+		, m_weights(weights)
+		, m_channelMask(hashChannelMask(weights))
+		, m_hashQuantum(hashQuantum(colorDistanceThreshold))
+		, m_rowStep(img.height() > 1 ? img.scanLine(1) - img.scanLine(0) : 0)
+	{
+	}
+
+	// Hashes all the rows of img up front, on several threads, as hash() would one by one
+	static void HashLines(const Image& img, double colorDistanceThreshold, const ImgDiffKernels::ColorDistanceWeights& weights,
+		WorkerPool& pool, std::vector<unsigned long>& hashes)
+	{
+		const ImgDiffKernels::HashLineFunc hashLine = ImgDiffKernels::GetKernels().hashLine;
+		const uint32_t channelMask = hashChannelMask(weights);
+		const unsigned quantum = hashQuantum(colorDistanceThreshold);
+		const unsigned width = img.width(), height = img.height();
+		hashes.resize(height);
+		pool.ParallelFor((height + HASH_ROWS_PER_TASK - 1) / HASH_ROWS_PER_TASK,
+			[&](unsigned task)
+			{
+				const unsigned y1 = (std::min)((task + 1) * HASH_ROWS_PER_TASK, height);
+				for (unsigned y = task * HASH_ROWS_PER_TASK; y < y1; ++y)
+					hashes[y] = foldHash(hashLine(img.scanLine(y), width, channelMask, quantum));
+			});
+	}
+	unsigned size() const { return m_img.height() * m_img.width() * 4; }
+	const char* data() const
+	{
+		return m_img.height() > 0 ? reinterpret_cast<const char *>(m_img.scanLine(0)) : nullptr;
+	}
+	const char* next(const char* scanline) const
+	{
+		return scanline + m_rowStep;
+	}
+	unsigned rowSize(const char*) const
+	{
+		return m_img.width() * 4;
+	}
+	bool equals(const char* scanline1, unsigned size1,
+		const char* scanline2, unsigned size2) const
+	{
+		return alineEquals(reinterpret_cast<const unsigned char *>(scanline1), size1 / 4, 
+			reinterpret_cast<const unsigned char *>(scanline2), size2 / 4, m_colorDistanceThreshold2, m_weights);
+	}
+	unsigned long hash(const char* scanline) const
+	{
+		return foldHash(ImgDiffKernels::GetKernels().hashLine(reinterpret_cast<const unsigned char *>(scanline),
+			m_img.width(), m_channelMask, m_hashQuantum));
+	}
+
+private:
+	enum { HASH_ROWS_PER_TASK = 64 };
+
+	const Image& m_img;
+	int m_colorDistanceThreshold2;
+	ImgDiffKernels::ColorDistanceWeights m_weights;
+	uint32_t m_channelMask;
+	unsigned m_hashQuantum;
+	ptrdiff_t m_rowStep; // from a row to the next one, negative since the bitmap is stored bottom-up
+};
+
+// The columns of an image as the lines of Diff<Data>, for the horizontal insertion detection.
+// Each line Diff<Data> walks is a Column that points into the image, so the columns are
+// hashed and compared in place, without a transposed copy of the image.
+class ColumnDataForDiff
+{
+public:
+	ColumnDataForDiff(const Image& img, double colorDistanceThreshold, const ImgDiffKernels::ColorDistanceWeights& weights)
+		: m_colorDistanceThreshold2(ImgDiffKernels::ColorDistanceThreshold2(colorDistanceThreshold))
+		, m_weights(weights)
+		, m_channelMask(hashChannelMask(weights))
+		, m_hashQuantum(hashQuantum(colorDistanceThreshold))
+	{
+		const unsigned width = img.width(), height = img.height();
+		if (height == 0)
+			return;
+		const ptrdiff_t step = height > 1 ? img.scanLine(1) - img.scanLine(0) : 0;
+		m_columns.resize(width);
+		for (unsigned x = 0; x < width; ++x)
+			m_columns[x] = { img.scanLine(0) + x * 4, step, height };
+	}
+
+	// Hashes all the columns of img up front, on several threads, as hash() would one by one.
+	// A block of columns, one cache line of each row, is gathered at a time into contiguous
+	// lines for the hash kernel. Each task hashes a few blocks with its own buffer.
+	static void HashLines(const Image& img, double colorDistanceThreshold, const ImgDiffKernels::ColorDistanceWeights& weights,
+		WorkerPool& pool, std::vector<unsigned long>& hashes)
+	{
+		const ImgDiffKernels::HashLineFunc hashLine = ImgDiffKernels::GetKernels().hashLine;
+		const uint32_t channelMask = hashChannelMask(weights);
+		const unsigned quantum = hashQuantum(colorDistanceThreshold);
+		const unsigned width = img.width(), height = img.height();
+		hashes.resize(height > 0 ? width : 0);
+		if (height == 0)
+			return;
+		pool.ParallelFor((width + HASH_COLUMNS_PER_TASK - 1) / HASH_COLUMNS_PER_TASK,
+			[&](unsigned task)
+			{
+				std::vector<unsigned char> block(static_cast<size_t>(HASH_BLOCK_COLUMNS) * height * 4);
+				const unsigned xend = (std::min)((task + 1) * HASH_COLUMNS_PER_TASK, width);
+				for (unsigned x0 = task * HASH_COLUMNS_PER_TASK; x0 < xend; x0 += HASH_BLOCK_COLUMNS)
+				{
+					const unsigned ncolumns = (std::min)(xend - x0, static_cast<unsigned>(HASH_BLOCK_COLUMNS));
+					for (unsigned y = 0; y < height; ++y)
+					{
+						const unsigned char *pixel = img.scanLine(y) + x0 * 4;
+						for (unsigned i = 0; i < ncolumns; ++i)
+							memcpy(&block[(static_cast<size_t>(i) * height + y) * 4], pixel + i * 4, 4);
+					}
+					for (unsigned i = 0; i < ncolumns; ++i)
+						hashes[x0 + i] = foldHash(hashLine(&block[static_cast<size_t>(i) * height * 4], height, channelMask, quantum));
+				}
+			});
+	}
+	unsigned size() const { return static_cast<unsigned>(m_columns.size() * sizeof(Column)); }
+	const char* data() const
+	{
+		return m_columns.empty() ? nullptr : reinterpret_cast<const char *>(m_columns.data());
+	}
+	const char* next(const char* column) const
+	{
+		return column + sizeof(Column);
+	}
+	unsigned rowSize(const char*) const
+	{
+		return sizeof(Column);
+	}
+	// Diff<Data> compares the columns of both images through one of them, so each column
+	// carries its own image layout
+	bool equals(const char* column1, unsigned,
+		const char* column2, unsigned) const
+	{
+		const Column& col1 = *reinterpret_cast<const Column *>(column1);
+		const Column& col2 = *reinterpret_cast<const Column *>(column2);
+		return acolumnEquals(col1.top, col1.step, col1.height, col2.top, col2.step, col2.height,
+			m_colorDistanceThreshold2, m_weights);
+	}
+	unsigned long hash(const char* column) const
+	{
+		const Column& col = *reinterpret_cast<const Column *>(column);
+		std::vector<unsigned char> pixels(col.height * 4);
+		for (unsigned y = 0; y < col.height; ++y)
+			memcpy(&pixels[y * 4], col.top + static_cast<ptrdiff_t>(y) * col.step, 4);
+		return foldHash(ImgDiffKernels::GetKernels().hashLine(pixels.data(), col.height, m_channelMask, m_hashQuantum));
+	}
+
+private:
+	enum { HASH_BLOCK_COLUMNS = 16, HASH_COLUMNS_PER_TASK = 128 };
+
+	struct Column
+	{
+		const unsigned char *top; // the pixel of the column in the first row
+		ptrdiff_t step;           // from a pixel of the column to the one below it
+		unsigned height;
+	};
+
+	std::vector<Column> m_columns;
+	int m_colorDistanceThreshold2;
+	ImgDiffKernels::ColorDistanceWeights m_weights;
+	uint32_t m_channelMask;
+	unsigned m_hashQuantum;
+};
+
+class CImgDiffBuffer
+{
+	friend class TemporaryTransformation;
+	typedef RunLengthArray2D<int> DiffBlocks;
+	typedef BitArray2D DiffMask;
+
+public:
+	enum INSERTION_DELETION_DETECTION_MODE {
+		INSERTION_DELETION_DETECTION_NONE = 0, INSERTION_DELETION_DETECTION_VERTICAL, INSERTION_DELETION_DETECTION_HORIZONTAL
+	};
+	enum OVERLAY_MODE {
+		OVERLAY_NONE = 0, OVERLAY_XOR, OVERLAY_ALPHABLEND, OVERLAY_ALPHABLEND_ANIM
+	};
+	enum WIPE_MODE {
+		WIPE_NONE = 0, WIPE_VERTICAL, WIPE_HORIZONTAL
+	};
+	enum DIFF_ALGORITHM {
+		MYERS_DIFF, MINIMAL_DIFF, PATIENCE_DIFF, HISTOGRAM_DIFF, NONE_DIFF
+	};
+	
+	enum { BLINK_INTERVAL = 800 };
+	enum { OVERLAY_ANIMATION_INTERVAL = 1000 };
+	enum { OVERLAY_ANIMATION_STEPS = 8 };
+	enum { OVERLAY_ANIMATION_CACHE_SIZE = 64 }; // megabytes
+	enum { MIN_BLOCK_SIZE_FOR_SPAN_COMPARE = 8 };
+	enum { COMPOSE_TILE_SIZE = 256 };
+	enum { MAX_DIRTY_RECTS = 32 };
+	enum { DIFF_MAP_MIN_ALPHA = 0x60 };
+	enum { MAX_MIPMAP_LEVEL = 10 };
+
+	CImgDiffBuffer() : 
+		  m_nImages(0)
+		, m_diffMapValid(false)
+		, m_showDifferences(true)
+		, m_blinkDifferences(false)
+		, m_vectorImageZoomRatio(1.0f)
+		, m_insertionDeletionDetectionMode(INSERTION_DELETION_DETECTION_NONE)
+		, m_overlayMode(OVERLAY_NONE)
+		, m_overlayAlpha(0.3)
+		, m_wipeMode(WIPE_NONE)
+		, m_wipePosition(0)
+		, m_diffBlockSize(8)
+		, m_selDiffColor(Image::Rgb(0xff, 0x40, 0x40))
+		, m_selDiffDeletedColor(Image::Rgb(0xf0, 0xc0, 0xc0))
+		, m_diffColor(Image::Rgb(0xff, 0xff, 0x40))
+		, m_diffDeletedColor(Image::Rgb(0xc0, 0xc0, 0xc0))
+		, m_diffColorAlpha(0.7)
+		, m_colorDistanceThreshold(0.0)
+		, m_colorDistanceWeights(ImgDiffKernels::ColorDistanceWeights::Unit())
+		, m_ignoreAlphaDifferences(false)
+		, m_currentDiffIndex(-1)
+		, m_diffCount(0)
+		, m_angle{}
+		, m_horizontalFlip{}
+		, m_verticalFlip{}
+		, m_temporarilyTransformed(false)
+		, m_diffAlgorithm(MYERS_DIFF)
+		, m_blinkInterval(BLINK_INTERVAL)
+		, m_overlayAnimationInterval(OVERLAY_ANIMATION_INTERVAL)
+		, m_overlayAnimationSteps(OVERLAY_ANIMATION_STEPS)
+		, m_overlayAnimationCacheSize(OVERLAY_ANIMATION_CACHE_SIZE)
+		, m_lastErrorCode(0)
+		, m_diffCostLimit(0)
+		, m_diffTimeLimit(0)
+		, m_lineDiffTruncated(false)
+		, m_compareThreadCount(0)
+		, m_composeShowDiff(false)
+		, m_composeOverlayAlpha(0.0)
+		, m_tileCountX(0)
+		, m_tileCountY(0)
+	{
+		for (int i = 0; i < 3; ++i)
+			m_currentPage[i] = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			m_imgDiffIsTransparent[i] = false;
+		}
+		m_workerPool.SetThreadCount(GetWorkerThreadCount(m_compareThreadCount, UINT_MAX) - 1);
+	}
+
+	virtual ~CImgDiffBuffer()
+	{
+		CloseImages();
+	}
+
+	const wchar_t *GetFileName(int pane)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return NULL;
+		return m_filename[pane].c_str();
+	}
+
+	int GetPaneCount() const
+	{
+		return m_nImages;
+	}
+
+	bool IsAnyPaneTransparent() const
+	{
+		for (int i = 0; i < m_nImages; ++i)
+			if (m_imgDiffIsTransparent[i])
+				return true;
+		return false;
+	}
+
+	bool IsPaneTransparent(int pane) const
+	{
+		return (pane >= 0 && pane < m_nImages) ? m_imgDiffIsTransparent[pane] : false;
+	}
+
+	Image::Color GetPixelColor(int pane, int x, int y) const
+	{
+		return m_imgPreprocessed[pane].pixel(x - m_offset[pane].x, y - m_offset[pane].y);
+	}
+
+	double GetColorDistance(int pane1, int pane2, int x, int y) const
+	{
+		return std::sqrt(static_cast<double>(
+			::GetColorDistance2(GetPixelColor(pane1, x, y), GetPixelColor(pane2, x, y)) ));
+	}
+
+	Image::Color GetDiffColor() const
+	{
+		return m_diffColor;
+	}
+
+	void SetDiffColor(Image::Color clrDiffColor)
+	{
+		if (memcmp(&m_diffColor, &clrDiffColor, sizeof(m_diffColor)) == 0)
+			return;
+		m_diffColor = clrDiffColor;
+		RefreshImages();
+	}
+
+	Image::Color GetDiffDeletedColor() const
+	{
+		return m_diffDeletedColor;
+	}
+
+	void SetDiffDeletedColor(Image::Color clrDiffDeletedColor)
+	{
+		if (memcmp(&m_diffDeletedColor, &clrDiffDeletedColor, sizeof(m_diffDeletedColor)) == 0)
+			return;
+		m_diffDeletedColor = clrDiffDeletedColor;
+		RefreshImages();
+	}
+
+	Image::Color GetSelDiffColor() const
+	{
+		return m_selDiffColor;
+	}
+
+	void SetSelDiffColor(Image::Color clrSelDiffColor)
+	{
+		if (memcmp(&m_selDiffColor, &clrSelDiffColor, sizeof(m_selDiffColor)) == 0)
+			return;
+		m_selDiffColor = clrSelDiffColor;
+		RefreshImages();
+	}
+
+	Image::Color GetSelDiffDeletedColor() const
+	{
+		return m_selDiffDeletedColor;
+	}
+
+	void SetSelDiffDeletedColor(Image::Color clrSelDiffDeletedColor)
+	{
+		if (memcmp(&m_selDiffDeletedColor, &clrSelDiffDeletedColor, sizeof(m_selDiffDeletedColor)) == 0)
+			return;
+		m_selDiffDeletedColor = clrSelDiffDeletedColor;
+		RefreshImages();
+	}
+
+	double GetDiffColorAlpha() const
+	{
+		return m_diffColorAlpha;
+	}
+
+	void SetDiffColorAlpha(double diffColorAlpha)
+	{
+		if (m_diffColorAlpha == diffColorAlpha)
+			return;
+		m_diffColorAlpha = diffColorAlpha;
+		RefreshImages();
+	}
+
+	int  GetCurrentPage(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return -1;
+		return m_currentPage[pane];
+	}
+
+	void SetCurrentPage(int pane, int page)
+	{
+		if (page >= 0 && page < GetPageCount(pane))
+		{
+			if (m_currentPage[pane] != page &&
+			    (m_imgOrigMultiPage[pane].isValid() || m_imgConverter[pane].isValid()))
+			{
+				m_currentPage[pane] = page;
+				ChangePage(pane, page);
+				CompareImages();
+			}
+		}
+	}
+
+	void SetCurrentPageAll(int page)
+	{
+		bool frecompare = false;
+		for (int pane = 0; pane < m_nImages; ++pane)
+		{
+			if (page >= 0 && page < GetPageCount(pane))
+			{
+				if (m_currentPage[pane] != page &&
+				    (m_imgOrigMultiPage[pane].isValid() || m_imgConverter[pane].isValid()))
+				{
+					m_currentPage[pane] = page;
+					ChangePage(pane, page);
+					frecompare = true;
+				}
+			}
+		}
+		if (frecompare)
+			CompareImages();
+	}
+
+	int  GetCurrentMaxPage() const
+	{
+		int maxpage = 0;
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			int page = GetCurrentPage(i);
+			maxpage = maxpage < page ? page : maxpage;
+		}
+		return maxpage;
+	}
+
+	int  GetPageCount(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return -1;
+		if (m_imgOrigMultiPage[pane].isValid())
+			return m_imgOrigMultiPage[pane].getPageCount();
+		if (m_imgConverter[pane].isValid())
+			return m_imgConverter[pane].getPageCount();
+		else
+			return 1;
+	}
+
+	int  GetMaxPageCount() const
+	{
+		int maxpage = 0;
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			int page = GetPageCount(i);
+			maxpage = page > maxpage ? page : maxpage;
+		}
+		return maxpage;
+	}
+
+	double GetColorDistanceThreshold() const
+	{
+		return m_colorDistanceThreshold;
+	}
+
+	void SetColorDistanceThreshold(double threshold)
+	{
+		if (m_colorDistanceThreshold == threshold)
+			return;
+		m_colorDistanceThreshold = threshold;
+		CompareImages();
+	}
+
+	ImgDiffKernels::ColorDistanceWeights GetColorDistanceWeights() const
+	{
+		return m_colorDistanceWeights;
+	}
+
+	void SetColorDistanceWeights(const ImgDiffKernels::ColorDistanceWeights& weights)
+	{
+		auto clamp = [](short w) -> short {
+			return (std::min)((std::max)(w, static_cast<short>(0)), static_cast<short>(ImgDiffKernels::MAX_COLOR_DISTANCE_WEIGHT));
+		};
+		ImgDiffKernels::ColorDistanceWeights clamped = { clamp(weights.b), clamp(weights.g), clamp(weights.r), clamp(weights.a) };
+		if (memcmp(&m_colorDistanceWeights, &clamped, sizeof(clamped)) == 0)
+			return;
+		m_colorDistanceWeights = clamped;
+		CompareImages();
+	}
+
+	bool GetIgnoreAlphaDifferences() const
+	{
+		return m_ignoreAlphaDifferences;
+	}
+
+	void SetIgnoreAlphaDifferences(bool ignore)
+	{
+		if (m_ignoreAlphaDifferences == ignore)
+			return;
+		m_ignoreAlphaDifferences = ignore;
+		CompareImages();
+	}
+
+	int  GetDiffBlockSize() const
+	{
+		return m_diffBlockSize;
+	}
+	
+	void SetDiffBlockSize(int blockSize)
+	{
+		if (m_diffBlockSize == blockSize)
+			return;
+		m_diffBlockSize = blockSize;
+		CompareImages();
+	}
+
+	INSERTION_DELETION_DETECTION_MODE GetInsertionDeletionDetectionMode() const
+	{
+		return m_insertionDeletionDetectionMode;
+	}
+
+	void SetInsertionDeletionDetectionMode(INSERTION_DELETION_DETECTION_MODE insertionDeletionDetectionMode)
+	{
+		if (m_insertionDeletionDetectionMode == insertionDeletionDetectionMode)
+			return;
+		m_insertionDeletionDetectionMode = insertionDeletionDetectionMode;
+		CompareImages();
+	}
+
+	OVERLAY_MODE GetOverlayMode() const
+	{
+		return m_overlayMode;
+	}
+
+	void SetOverlayMode(OVERLAY_MODE overlayMode)
+	{
+		if (m_overlayMode == overlayMode)
+			return;
+		m_overlayMode = overlayMode;
+		RefreshImages();
+	}
+
+	double GetOverlayAlpha() const
+	{
+		return m_overlayAlpha;
+	}
+
+	void SetOverlayAlpha(double overlayAlpha)
+	{
+		if (m_overlayAlpha == overlayAlpha)
+			return;
+		m_overlayAlpha = overlayAlpha;
+		RefreshImages();
+	}
+
+	WIPE_MODE GetWipeMode() const
+	{
+		return m_wipeMode;
+	}
+
+	void SetWipeMode(WIPE_MODE wipeMode)
+	{
+		if (m_wipeMode == wipeMode)
+			return;
+		m_wipeMode = wipeMode;
+		RefreshImages();
+		UpdateDiffTransparencyCache();
+	}
+
+	int GetWipePosition() const
+	{
+		return m_wipePosition;
+	}
+
+	void SetWipePosition(int pos)
+	{
+		if (m_wipePosition == pos)
+			return;
+		const int oldWipePosition = m_wipePosition;
+		m_wipePosition = pos;
+		ClampWipePosition();
+		// the split is applied when the tiles are composited, so only the band of pixels
+		// between the old and the new split changes sides
+		const int bandBegin = (std::min)(oldWipePosition, m_wipePosition);
+		const int bandEnd = (std::max)(oldWipePosition, m_wipePosition);
+		if (m_wipeMode == WIPE_VERTICAL)
+			InvalidateTiles(Rect<int>(0, bandBegin, INT_MAX, bandEnd));
+		else if (m_wipeMode == WIPE_HORIZONTAL)
+			InvalidateTiles(Rect<int>(bandBegin, 0, bandEnd, INT_MAX));
+	}
+
+	void SetWipeModePosition(WIPE_MODE wipeMode, int pos)
+	{
+		if (m_wipeMode == wipeMode && m_wipePosition == pos)
+			return;
+		m_wipeMode = wipeMode;
+		m_wipePosition = pos;
+		RefreshImages();
+	}
+
+	bool GetShowDifferences() const
+	{
+		return m_showDifferences;
+	}
+
+	void SetShowDifferences(bool visible)
+	{
+		if (m_showDifferences == visible)
+			return;
+		m_showDifferences = visible;
+		CompareImages();
+	}
+
+	bool GetBlinkDifferences() const
+	{
+		return m_blinkDifferences;
+	}
+
+	void SetBlinkDifferences(bool blink)
+	{
+		if (m_blinkDifferences == blink)
+			return;
+		m_blinkDifferences = blink;
+		RefreshImages();
+	}
+
+	float GetVectorImageZoomRatio() const
+	{
+		return m_vectorImageZoomRatio;
+	}
+
+	void SetVectorImageZoomRatio(float zoom)
+	{
+		if (m_vectorImageZoomRatio == zoom)
+			return;
+		m_vectorImageZoomRatio = zoom;
+		for (int pane = 0; pane < m_nImages; ++pane)
+		{
+			if (m_imgConverter[pane].isValid())
+				ChangePage(pane, m_currentPage[pane]);
+		}
+		CompareImages();
+	}
+
+	float GetRotation(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return 0.f;
+		return m_angle[pane];
+	}
+
+	void SetRotation(int pane, float angle)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return;
+		if (angle >= 360.f)
+			angle = angle - 360.f * (static_cast<int>(angle) / 360);
+		else if (angle < 0.f)
+			angle = angle + 360.f * (1 + (static_cast<int>(-angle) / 360));
+		if (m_angle[pane] == angle)
+			return;
+		m_angle[pane] = angle;
+		CompareImages();
+	}
+
+	bool GetHorizontalFlip(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return false;
+		return m_horizontalFlip[pane];
+	}
+
+	void SetHorizontalFlip(int pane, bool flip)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return;
+		if (m_horizontalFlip[pane] == flip)
+			return;
+		m_horizontalFlip[pane] = flip;
+		CompareImages();
+	}
+
+	bool GetVerticalFlip(int pane ) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return false;
+		return m_verticalFlip[pane];
+	}
+
+	void SetVerticalFlip(int pane, bool flip)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return;
+		if (m_verticalFlip[pane] == flip)
+			return;
+		m_verticalFlip[pane] = flip;
+		CompareImages();
+	}
+
+	DIFF_ALGORITHM GetDiffAlgorithm() const
+	{
+		return m_diffAlgorithm;
+	}
+
+	void SetDiffAlgorithm(DIFF_ALGORITHM diffAlgorithm)
+	{
+		if (m_diffAlgorithm == diffAlgorithm)
+			return;
+		m_diffAlgorithm = diffAlgorithm;
+		CompareImages();
+	}
+
+	int  GetDiffCostLimit() const
+	{
+		return m_diffCostLimit;
+	}
+
+	/* The edit cost at which each split of the line diff of the insertion detection stops
+	   looking for a shorter alignment and takes the furthest reaching one, even with
+	   MINIMAL_DIFF. 0 for no limit. */
+	void SetDiffCostLimit(int cost)
+	{
+		cost = (std::max)(cost, 0);
+		if (m_diffCostLimit == cost)
+			return;
+		m_diffCostLimit = cost;
+		CompareImages();
+	}
+
+	int  GetDiffTimeLimit() const
+	{
+		return m_diffTimeLimit;
+	}
+
+	/* The milliseconds after which a line diff of the insertion detection finishes with the
+	   furthest reaching alignments. 0 for no limit. */
+	void SetDiffTimeLimit(int milliseconds)
+	{
+		milliseconds = (std::max)(milliseconds, 0);
+		if (m_diffTimeLimit == milliseconds)
+			return;
+		m_diffTimeLimit = milliseconds;
+		CompareImages();
+	}
+
+	/* Whether the cost or time limit cut the last line diff short, so that the ghost lines
+	   may differ from those of an unlimited diff */
+	bool IsLineDiffTruncated() const
+	{
+		return m_lineDiffTruncated;
+	}
+
+	int  GetCompareThreadCount() const
+	{
+		return m_compareThreadCount;
+	}
+
+	/* 0 uses one thread per core, 1 compares and composites on the calling thread only.
+	   The worker threads are started by the first compare or paint that can use them and
+	   kept until the count changes.
+	   The result does not depend on the thread count, so no recompare is needed. */
+	void SetCompareThreadCount(int threadCount)
+	{
+		m_compareThreadCount = (std::max)(threadCount, 0);
+		m_workerPool.SetThreadCount(GetWorkerThreadCount(m_compareThreadCount, UINT_MAX) - 1);
+	}
+
+	const DiffInfo *GetDiffInfo(int diffIndex) const
+	{
+		if (diffIndex < 0 || diffIndex >= m_diffCount)
+			return NULL;
+		return &m_diffInfos[diffIndex];
+	}
+
+	int  GetDiffCount() const
+	{
+		return m_diffCount;
+	}
+
+	// Returns true when comparing the panes would not find any difference, taking the offsets
+	// and the color distance settings into account. Stops at the first differing line.
+	bool AreImagesIdentical()
+	{
+		if (m_nImages <= 1)
+			return true;
+		TemporaryTransformation tmp(*this);
+		return AreImagesIdentical(m_imgOrig32);
+	}
+
+	int  GetConflictCount() const
+	{
+		int conflictCount = 0;
+		for (int i = 0; i < m_diffCount; ++i)
+			if (m_diffInfos[i].op == OP_DIFF)
+				++conflictCount;
+		return conflictCount;
+	}
+
+	int  GetCurrentDiffIndex() const
+	{
+		return m_currentDiffIndex;
+	}
+
+	bool FirstDiff()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		if (m_diffCount == 0)
+			m_currentDiffIndex = -1;
+		else
+			m_currentDiffIndex = 0;
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool LastDiff()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		m_currentDiffIndex = m_diffCount - 1;
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool NextDiff()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		++m_currentDiffIndex;
+		if (m_currentDiffIndex >= m_diffCount)
+			m_currentDiffIndex = m_diffCount - 1;
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool PrevDiff()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		if (m_diffCount == 0)
+			m_currentDiffIndex = -1;
+		else
+		{
+			--m_currentDiffIndex;
+			if (m_currentDiffIndex < 0)
+				m_currentDiffIndex = 0;
+		}
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool FirstConflict()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		for (size_t i = 0; i < m_diffInfos.size(); ++i)
+			if (m_diffInfos[i].op == OP_DIFF)
+				m_currentDiffIndex = static_cast<int>(i);
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool LastConflict()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		for (int i = static_cast<int>(m_diffInfos.size() - 1); i >= 0; --i)
+		{
+			if (m_diffInfos[i].op == OP_DIFF)
+			{
+				m_currentDiffIndex = i;
+				break;
+			}
+		}
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool NextConflict()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		for (size_t i = m_currentDiffIndex + 1; i < m_diffInfos.size(); ++i)
+		{
+			if (m_diffInfos[i].op == OP_DIFF)
+			{
+				m_currentDiffIndex = static_cast<int>(i);
+				break;
+			}
+		}
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool PrevConflict()
+	{
+		int oldDiffIndex = m_currentDiffIndex;
+		for (int i = m_currentDiffIndex - 1; i >= 0; --i)
+		{
+			if (m_diffInfos[i].op == OP_DIFF)
+			{
+				m_currentDiffIndex = i;
+				break;
+			}
+		}
+		if (oldDiffIndex == m_currentDiffIndex)
+			return false;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+
+	bool SelectDiff(int diffIndex)
+	{
+		if (diffIndex == m_currentDiffIndex || diffIndex < -1 || diffIndex >= m_diffCount)
+			return false;
+		int oldDiffIndex = m_currentDiffIndex;
+		m_currentDiffIndex = diffIndex;
+		RefreshSelectedDiff(oldDiffIndex);
+		return true;
+	}
+	
+	int  GetNextDiffIndex() const
+	{
+		if (m_diffCount == 0 || m_currentDiffIndex >= m_diffCount - 1)
+			return -1;
+		return m_currentDiffIndex + 1;
+	}
+
+	int  GetPrevDiffIndex() const
+	{
+		if (m_diffCount == 0 || m_currentDiffIndex <= 0)
+			return -1;
+		return m_currentDiffIndex - 1;
+	}
+
+	int  GetNextConflictIndex() const
+	{
+		for (size_t i = m_currentDiffIndex + 1; i < m_diffInfos.size(); ++i)
+			if (m_diffInfos[i].op == OP_DIFF)
+				return static_cast<int>(i);
+		return -1;
+	}
+
+	int  GetPrevConflictIndex() const
+	{
+		for (int i = static_cast<int>(m_currentDiffIndex - 1); i >= 0; --i)
+			if (m_diffInfos[i].op == OP_DIFF)
+				return i;
+		return -1;
+	}
+
+	void CompareImages()
+	{
+		if (m_nImages <= 1)
+			return;
+		CompareImagesInternal();
+		RefreshImages();
+	}
+
+	// Fixes the state of the layers for the next frame. The pixels are composited later,
+	// tile by tile, when ComposeRect or GetImage asks for them.
+	void RefreshImages()
+	{
+		if (m_nImages <= 1)
+			return;
+		InitializeDiffImages();
+		m_composeShowDiff = GetCurrentShowDiff();
+		m_composeOverlayAlpha = GetCurrentOverlayAlpha();
+		ClampWipePosition();
+		m_diffMapValid = false;
+		InvalidateTiles();
+		UpdateDiffTransparencyCache();
+		UpdateComposePassThrough();
+	}
+
+	// Moves the blink and the overlay animation on to the current time. Returns whether the
+	// frame changed. A blink tick only swaps the front frame with the back one, which keeps
+	// the tiles already composited with the highlight flipped. A step of the animated overlay
+	// takes the frames of the new alpha, with their mipmap pyramids, from the overlay frame
+	// cache when they are there.
+	bool UpdateAnimationFrame()
+	{
+		if (m_nImages <= 1)
+			return false;
+		bool changed = false;
+		const double overlayAlpha = GetCurrentOverlayAlpha();
+		if (m_composeOverlayAlpha != overlayAlpha)
+		{
+			const bool showDiff = GetCurrentShowDiff();
+			ExchangeOverlayFrame(m_imgDiff, m_tileComposed, m_mipmaps, m_composeShowDiff, overlayAlpha, showDiff);
+			if (IsBlinking())
+				ExchangeOverlayFrame(m_imgDiffBack, m_tileComposedBack, m_mipmapsBack, !m_composeShowDiff, overlayAlpha, !showDiff);
+			m_composeOverlayAlpha = overlayAlpha;
+			m_composeShowDiff = showDiff;
+			changed = true;
+		}
+		else if (m_composeShowDiff != GetCurrentShowDiff())
+		{
+			for (int i = 0; i < m_nImages; ++i)
+			{
+				m_imgDiff[i].swap(m_imgDiffBack[i]);
+				m_tileComposed[i].swap(m_tileComposedBack[i]);
+				SwapMipmaps(m_mipmaps[i], m_mipmapsBack[i]);
+				MarkImageModified(m_imgDiff[i]);
+			}
+			m_composeShowDiff = !m_composeShowDiff;
+			changed = true;
+		}
+		if (changed)
+		{
+			for (int i = 0; i < m_nImages; ++i)
+				AddDirtyRect(i, Rect<int>(0, 0, INT_MAX, INT_MAX));
+			UpdateComposePassThrough();
+		}
+		return changed;
+	}
+
+	// A pane that gets no overlay, no highlight and no wipe looks exactly like its preprocessed
+	// image, so hosts can draw that one through GetDisplayImage instead of compositing a copy.
+	void UpdateComposePassThrough()
+	{
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			m_composePassThrough[i] = IsComposePassThrough(i, m_composeShowDiff);
+			if (m_composePassThrough[i])
+				MarkImageModified(m_imgPreprocessed[i]);
+		}
+	}
+
+	bool IsComposePassThrough(int pane, bool markDiff) const
+	{
+		const bool overlay =
+			(m_overlayMode == OVERLAY_XOR) ||
+			((m_overlayMode == OVERLAY_ALPHABLEND || m_overlayMode == OVERLAY_ALPHABLEND_ANIM) &&
+			 ImgDiffKernels::FixedPointAlpha(m_composeOverlayAlpha) != 0);
+		return !overlay && !(markDiff && m_diffCount > 0) && m_wipeMode == WIPE_NONE &&
+			m_offset[pane].x == 0 && m_offset[pane].y == 0 &&
+			m_imgPreprocessed[pane].width() == m_imgDiff[pane].width() &&
+			m_imgPreprocessed[pane].height() == m_imgDiff[pane].height();
+	}
+
+	// Whether the blink frames are used, i.e. the highlight is shown every other tick
+	bool IsBlinking() const
+	{
+		return m_showDifferences && m_blinkDifferences;
+	}
+
+	// Moves the highlight from diff oldDiffIndex to the current diff. Only the tiles
+	// covering the two diffs have to be composited again.
+	void RefreshSelectedDiff(int oldDiffIndex)
+	{
+		m_diffMapValid = false;
+		if (!m_showDifferences)
+			return;
+		const int diffIndexes[2] = { oldDiffIndex, m_currentDiffIndex };
+		for (int diffIndex : diffIndexes)
+		{
+			if (diffIndex < 0 || diffIndex >= static_cast<int>(m_diffInfos.size()))
+				continue;
+			const Rect<int>& rc = m_diffInfos[diffIndex].rc;
+			const int bs = static_cast<int>(m_diffBlockSize);
+			InvalidateTiles(Rect<int>(rc.left * bs, rc.top * bs, rc.right * bs, rc.bottom * bs));
+		}
+	}
+
+	// Derived from the layers, since the composited pixels only exist for the tiles asked for.
+	// A pane counts as transparent when any layer that can show through it is transparent.
+	void UpdateDiffTransparencyCache()
+	{
+		const unsigned w = m_imgDiff[0].width();
+		const unsigned h = m_imgDiff[0].height();
+		bool layerTransparent[3] = {};
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			layerTransparent[i] = m_imgPreprocessedIsTransparent[i] ||
+				m_offset[i].x > 0 || m_offset[i].y > 0 ||
+				m_offset[i].x + m_imgPreprocessed[i].width() < w ||
+				m_offset[i].y + m_imgPreprocessed[i].height() < h;
+		}
+		const bool alphaBlend = (m_overlayMode == OVERLAY_ALPHABLEND || m_overlayMode == OVERLAY_ALPHABLEND_ANIM);
+		bool composedTransparent[3] = {};
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			composedTransparent[i] = layerTransparent[i];
+			for (int src = i - 1; src <= i + 1; src += 2)
+			{
+				if (alphaBlend && src >= 0 && src < m_nImages && layerTransparent[src])
+					composedTransparent[i] = true;
+			}
+		}
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			m_imgDiffIsTransparent[i] = composedTransparent[i] ||
+				(m_wipeMode != WIPE_NONE && composedTransparent[(i + 1) % m_nImages]);
+		}
+	}
+
+	// Prepares the rectangle of the image GetDisplayImage returns for pane. Hosts call this for
+	// the visible part of a pane before drawing it. While blinking, the other blink frame is
+	// composited as well, so that the blink ticks do not composite anything.
+	void ComposeRect(int pane, int left, int top, int right, int bottom) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return;
+		if (!m_composePassThrough[pane])
+			ComposeTiles(pane, left, top, right, bottom);
+		if (IsBlinking() && !IsComposePassThrough(pane, !m_composeShowDiff))
+			ComposeTiles(pane, left, top, right, bottom, true);
+	}
+
+	// Composites the tiles of the front diff image of pane, or of the back one with the highlight
+	// flipped, that intersect the rectangle and have changed since they were last composited.
+	void ComposeTiles(int pane, int left, int top, int right, int bottom, bool back = false) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return;
+		Image& dst = back ? m_imgDiffBack[pane] : m_imgDiff[pane];
+		std::vector<unsigned char>& composed = back ? m_tileComposedBack[pane] : m_tileComposed[pane];
+		const bool markDiff = back ? !m_composeShowDiff : m_composeShowDiff;
+		if (composed.empty())
+			return;
+		left   = (std::max)(left, 0);
+		top    = (std::max)(top, 0);
+		right  = (std::min)(right, static_cast<int>(dst.width()));
+		bottom = (std::min)(bottom, static_cast<int>(dst.height()));
+		if (left >= right || top >= bottom)
+			return;
+		std::vector<unsigned> tiles;
+		for (unsigned ty = top / COMPOSE_TILE_SIZE; ty <= static_cast<unsigned>(bottom - 1) / COMPOSE_TILE_SIZE; ++ty)
+		{
+			for (unsigned tx = left / COMPOSE_TILE_SIZE; tx <= static_cast<unsigned>(right - 1) / COMPOSE_TILE_SIZE; ++tx)
+			{
+				const unsigned tile = ty * m_tileCountX + tx;
+				if (!composed[tile])
+				{
+					composed[tile] = 1;
+					tiles.push_back(tile);
+				}
+			}
+		}
+		if (tiles.empty())
+			return;
+		// tiles do not overlap, so they can be composited in any order
+		m_workerPool.ParallelFor(static_cast<unsigned>(tiles.size()),
+			[&](unsigned i) { ComposeTile(pane, tiles[i] % m_tileCountX, tiles[i] / m_tileCountX, dst, markDiff); });
+		MarkImageModified(dst);
+	}
+
+	// The level of the mipmap pyramid to draw a pane at zoom, which is the most reduced level
+	// that still has at least one pixel for each pixel drawn. Level 0 is the full size image.
+	int GetMipmapLevel(double zoom) const
+	{
+		int level = 0;
+		while (level < MAX_MIPMAP_LEVEL && zoom * (2 << level) <= 1.0)
+			++level;
+		return level;
+	}
+
+	// Prepares the rectangle, in coordinates of the diff image, of a level of the mipmap pyramid
+	// of pane and returns the image of that level, whose size is that of the diff image divided
+	// by 2^level and rounded up. Level 0 is the image GetDisplayImage returns. A level is reduced
+	// tile by tile from the level below, and only the tiles that changed since they were last
+	// reduced are reduced again, so that panning a zoomed out pane scales down little or nothing.
+	Image *ComposeMipmapRect(int pane, int level, int left, int top, int right, int bottom)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return NULL;
+		level = (std::max)(0, (std::min)(level, static_cast<int>(MAX_MIPMAP_LEVEL)));
+		if (level == 0)
+		{
+			ComposeRect(pane, left, top, right, bottom);
+			return GetDisplayImage(pane);
+		}
+		const Image& image = *GetDisplayImage(pane);
+		left   = (std::max)(left, 0);
+		top    = (std::max)(top, 0);
+		right  = (std::min)(right, static_cast<int>(image.width()));
+		bottom = (std::min)(bottom, static_cast<int>(image.height()));
+		const int scale = 1 << level;
+		if (left < right && top < bottom)
+		{
+			left   = left / scale;
+			top    = top / scale;
+			right  = (right + scale - 1) / scale;
+			bottom = (bottom + scale - 1) / scale;
+		}
+		else
+		{
+			left = top = right = bottom = 0;
+		}
+		ReduceMipmapRect(pane, level, left, top, right, bottom);
+		// the other blink frame is reduced as well, so that the blink ticks do not reduce anything
+		if (IsBlinking())
+			ReduceMipmapRect(pane, level, left, top, right, bottom, true);
+		return &m_mipmaps[pane][level - 1].image;
+	}
+
+	bool OpenImages(int nImages, const wchar_t * const filename[3])
+	{
+		CloseImages();
+		m_nImages = nImages;
+		for (int i = 0; i < nImages; ++i)
+			m_filename[i] = filename[i];
+		return LoadImages();
+	}
+
+	virtual bool CloseImages()
+	{
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			m_imgConverter[i].close();
+			m_imgOrigMultiPage[i].close();
+			m_imgOrig[i].clear();
+			m_imgOrig32[i].clear();
+			m_imgPreprocessed[i].clear();
+			m_tileComposed[i].clear();
+			m_tileComposedBack[i].clear();
+			m_composePassThrough[i] = false;
+			m_dirtyRects[i].clear();
+			ClearMipmaps(m_mipmaps[i]);
+			ClearMipmaps(m_mipmapsBack[i]);
+			ImageModified(i);
+			m_lineHashes[i].valid = false;
+			m_lineHashes[i].hashes.clear();
+			m_offset[i].x = 0;
+			m_offset[i].y = 0;
+		}
+		m_overlayFrames.clear();
+		m_diffMapCounts.clear();
+		m_diffMapCounts.shrink_to_fit();
+		m_diffMapValid = false;
+		m_nImages = 0;
+		return true;
+	}
+
+	bool SaveDiffImageAs(int pane, const wchar_t *filename)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return false;
+		ComposeTiles(pane, 0, 0, INT_MAX, INT_MAX);
+		int savedErrno = errno;
+		errno = 0;
+		bool result = !!m_imgDiff[pane].save(filename);
+		if (!result)
+			m_lastErrorCode = errno != 0 ? errno : ENOTSUP;
+		if (errno == 0)
+			errno = savedErrno;
+		return result;
+	}
+
+	int  GetImageWidth(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return -1;
+		if (m_angle[pane] == 0.f || m_angle[pane] == 180.f)
+			return m_imgOrig32[pane].width();
+		else
+			return m_imgOrig32[pane].height();
+	}
+
+	int  GetImageHeight(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return -1;
+		if (m_angle[pane] == 0.f || m_angle[pane] == 180.f)
+			return m_imgOrig32[pane].height();
+		else
+			return m_imgOrig32[pane].width();
+	}
+
+	int  GetPreprocessedImageWidth(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return -1;
+		return m_imgPreprocessed[pane].width();
+	}
+
+	int  GetPreprocessedImageHeight(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return -1;
+		return m_imgPreprocessed[pane].height();
+	}
+
+	int  GetDiffImageWidth() const
+	{
+		if (m_nImages <= 0)
+			return -1;
+		return m_imgDiff[0].width();
+	}
+
+	int  GetDiffImageHeight() const
+	{
+		if (m_nImages <= 0)
+			return -1;
+		return m_imgDiff[0].height();
+	}
+
+	int  GetImageBitsPerPixel(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return -1;
+		return m_imgOrig[pane].depth();
+	}
+
+	int GetDiffIndexFromPoint(int x, int y) const
+	{
+		if (x > 0 && y > 0 && 
+			x < static_cast<int>(m_imgDiff[0].width()) &&
+			y < static_cast<int>(m_imgDiff[0].height()))
+		{
+			return m_diff(x / m_diffBlockSize, y / m_diffBlockSize) - 1;
+		}
+		return -1;
+	}
+
+	Image *GetImage(int pane)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return NULL;
+		ComposeTiles(pane, 0, 0, INT_MAX, INT_MAX);
+		return &m_imgDiff[pane];
+	}
+
+	const Image *GetImage(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return NULL;
+		ComposeTiles(pane, 0, 0, INT_MAX, INT_MAX);
+		return &m_imgDiff[pane];
+	}
+
+	// The image to draw for pane, which has the size of the diff image. It is the preprocessed
+	// image itself while nothing is composited over it, otherwise the diff image, of which only
+	// the parts passed to ComposeRect are up to date.
+	Image *GetDisplayImage(int pane)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return NULL;
+		return m_composePassThrough[pane] ? &m_imgPreprocessed[pane] : &m_imgDiff[pane];
+	}
+
+	// Returns the rectangles of the image of pane that changed since the last call and forgets
+	// them, so that hosts can repaint only those. A rectangle as large as the diff image means
+	// that the whole pane has to be repainted.
+	std::vector<Rect<int> > TakeDirtyRects(int pane)
+	{
+		std::vector<Rect<int> > rects;
+		if (pane >= 0 && pane < m_nImages)
+			rects.swap(m_dirtyRects[pane]);
+		return rects;
+	}
+
+	const Image *GetPreprocessedImage(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return NULL;
+		return &m_imgPreprocessed[pane];
+	}
+
+	const Image *GetOriginalImage(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return NULL;
+		return &m_imgOrig[pane];
+	}
+
+	// The location map of the diffs, w by h pixels. A pixel gets the diff color with an alpha
+	// that grows with the share of the blocks under it that differ, or the selected diff color
+	// when the selected diff is under it. The map is kept until the diffs or the selection change.
+	Image *GetDiffMapImage(unsigned w, unsigned h)
+	{
+		if (m_diffMapValid && m_imgDiffMap.width() == w && m_imgDiffMap.height() == h)
+			return &m_imgDiffMap;
+		m_imgDiffMap.clear();
+		m_imgDiffMap.setSize(w, h);
+		m_diffMapValid = true;
+		const Size<unsigned> size = GetMaxWidthHeight();
+		const unsigned nBlocksX = static_cast<unsigned>(m_diff.width());
+		const unsigned nBlocksY = static_cast<unsigned>(m_diff.height());
+		if (m_nImages == 0 || w == 0 || h == 0 || nBlocksX == 0 || nBlocksY == 0)
+			return &m_imgDiffMap;
+		if (m_diffMapCounts.empty())
+			BuildDiffMapCounts();
+
+		// the blocks under each column and row of the map, at least one
+		auto blockRanges = [&](unsigned mapSize, unsigned imageSize, unsigned nBlocks)
+		{
+			std::vector<std::pair<unsigned, unsigned> > ranges(mapSize);
+			const uint64_t divisor = static_cast<uint64_t>(mapSize) * m_diffBlockSize;
+			for (unsigned i = 0; i < mapSize; ++i)
+			{
+				unsigned begin = static_cast<unsigned>(static_cast<uint64_t>(i) * imageSize / divisor);
+				unsigned end = static_cast<unsigned>((static_cast<uint64_t>(i + 1) * imageSize + divisor - 1) / divisor);
+				begin = (std::min)(begin, nBlocks - 1);
+				end = (std::min)((std::max)(end, begin + 1), nBlocks);
+				ranges[i] = { begin, end };
+			}
+			return ranges;
+		};
+		const auto columns = blockRanges(w, size.cx, nBlocksX);
+		const auto rows = blockRanges(h, size.cy, nBlocksY);
+
+		// the blocks of the selected diff are counted the same way, over its rectangle only
+		Rect<int> rcSel(0, 0, 0, 0);
+		std::vector<unsigned> selCounts;
+		if (m_currentDiffIndex >= 0 && m_currentDiffIndex < static_cast<int>(m_diffInfos.size()))
+		{
+			rcSel = m_diffInfos[m_currentDiffIndex].rc;
+			BuildDiffMapCounts(m_currentDiffIndex + 1, rcSel, selCounts);
+		}
+		const unsigned selStride = rcSel.right - rcSel.left + 1;
+
+		const unsigned stride = nBlocksX + 1;
+		for (unsigned y = 0; y < h; ++y)
+		{
+			const unsigned by0 = rows[y].first, by1 = rows[y].second;
+			const unsigned *sums0 = &m_diffMapCounts[by0 * stride];
+			const unsigned *sums1 = &m_diffMapCounts[by1 * stride];
+			unsigned char *scanline = m_imgDiffMap.scanLine(y);
+			for (unsigned x = 0; x < w; ++x)
+			{
+				const unsigned bx0 = columns[x].first, bx1 = columns[x].second;
+				const unsigned count = sums1[bx1] - sums1[bx0] - sums0[bx1] + sums0[bx0];
+				if (count == 0)
+					continue;
+				Image::Color color = m_diffColor;
+				unsigned alpha = DIFF_MAP_MIN_ALPHA;
+				const uint64_t area = static_cast<uint64_t>(bx1 - bx0) * (by1 - by0);
+				alpha += static_cast<unsigned>(((0xff - DIFF_MAP_MIN_ALPHA) * count + area / 2) / area);
+				if (!selCounts.empty())
+				{
+					const int sx0 = std::clamp(static_cast<int>(bx0), rcSel.left, rcSel.right) - rcSel.left;
+					const int sx1 = std::clamp(static_cast<int>(bx1), rcSel.left, rcSel.right) - rcSel.left;
+					const int sy0 = std::clamp(static_cast<int>(by0), rcSel.top, rcSel.bottom) - rcSel.top;
+					const int sy1 = std::clamp(static_cast<int>(by1), rcSel.top, rcSel.bottom) - rcSel.top;
+					if (selCounts[sy1 * selStride + sx1] - selCounts[sy1 * selStride + sx0] -
+					    selCounts[sy0 * selStride + sx1] + selCounts[sy0 * selStride + sx0] != 0)
+					{
+						color = m_selDiffColor;
+						alpha = 0xff;
+					}
+				}
+				scanline[x * 4 + 0] = Image::valueB(color);
+				scanline[x * 4 + 1] = Image::valueG(color);
+				scanline[x * 4 + 2] = Image::valueR(color);
+				scanline[x * 4 + 3] = static_cast<unsigned char>(alpha);
+			}
+		}
+		MarkImageModified(m_imgDiffMap);
+		return &m_imgDiffMap;
+	}
+
+	Point<unsigned> GetImageOffset(int pane) const
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return Point<unsigned>();
+		return m_offset[pane];
+	}
+
+	void AddImageOffset(int pane, int dx, int dy)
+	{
+		if (pane < 0 || pane >= m_nImages)
+			return;
+		int minx = INT_MAX, miny = INT_MAX;
+		Point<int> offset[3];
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			offset[i].x = m_offset[i].x;
+			offset[i].y = m_offset[i].y;
+			if (i == pane)
+			{
+				offset[i].x += dx;
+				offset[i].y += dy;
+			}
+			if (offset[i].x < minx)
+				minx = offset[i].x;
+			if (offset[i].y < miny)
+				miny = offset[i].y;
+		}
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			m_offset[i].x = offset[i].x - minx;
+			m_offset[i].y = offset[i].y - miny;
+		}
+		CompareImages();
+		RefreshImages();
+	}
+
+	bool ConvertToRealPos(int pane, int x, int y, int& rx, int& ry, bool clamp = true) const
+	{
+		x -= m_offset[pane].x;
+		y -= m_offset[pane].y;
+
+		bool inside = true;
+		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_NONE ||
+			m_lineDiffInfos.size() == 0)
+		{
+			if (x < 0)
+			{
+				rx = clamp ? 0 : x;
+				inside = false;
+			}
+			else if (x >= static_cast<int>(m_imgPreprocessed[pane].width()))
+			{
+				rx = clamp ? (m_imgPreprocessed[pane].width() - 1) : x;
+				inside = false;
+			}
+			else
+				rx = x;
+			if (y < 0)
+			{
+				ry = clamp ? 0 : y;
+				inside = false;
+			}
+			else if (y >= static_cast<int>(m_imgPreprocessed[pane].height()))
+			{
+				ry = clamp ? (m_imgPreprocessed[pane].height() - 1) : y;
+				inside = false;
+			}
+			else
+				ry = y;
+			return inside;
+		}
+
+		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_VERTICAL)
+		{
+			if (x < 0)
+			{
+				rx = clamp ? 0 : x;
+				inside = false;
+			}
+			else if (x >= static_cast<int>(m_imgPreprocessed[pane].width()))
+			{
+				rx = clamp ? (m_imgPreprocessed[pane].width() - 1) : x;
+				inside = false;
+			}
+			else
+				rx = x;
+			for (auto& lineDiff: m_lineDiffInfos)
+			{
+				if (y <= lineDiff.dend[pane])
+				{
+					if (y < 0)
+					{
+						ry = clamp ? 0 : y;
+						inside = false;
+					}
+					else
+						ry = y - lineDiff.dbegin + lineDiff.begin[pane];
+					return inside;
+				}
+				else if (lineDiff.dend[pane] < y && y <= lineDiff.dendmax)
+				{
+					ry = lineDiff.end[pane];
+					inside = false;
+					return inside;
+				}
+			}
+			ry = y - m_lineDiffInfos.back().dendmax + m_lineDiffInfos.back().end[pane];
+			if (ry >= GetImageHeight(pane))
+			{
+				if (clamp)
+					ry = GetImageHeight(pane) - 1;
+				inside = false;
+			}
+			return inside;
+		}
+		else
+		{
+			if (y < 0)
+			{
+				ry = clamp ? 0 : y;
+				inside = false;
+			}
+			else if (y >= static_cast<int>(m_imgPreprocessed[pane].height()))
+			{
+				ry = clamp ? (m_imgPreprocessed[pane].height() - 1) : y;
+				inside = false;
+			}
+			else
+				ry = y;
+			for (auto& lineDiff: m_lineDiffInfos)
+			{
+				if (x <= lineDiff.dend[pane])
+				{
+					if (x < 0)
+					{
+						rx = clamp ? 0 : x;
+						inside = false;
+					}
+					else
+						rx = x - lineDiff.dbegin + lineDiff.begin[pane];
+					return inside;
+				}
+				else if (lineDiff.dend[pane] < x && x <= lineDiff.dendmax)
+				{
+					rx = lineDiff.end[pane];
+					inside = false;
+					return inside;
+				}
+			}
+			rx = x - m_lineDiffInfos.back().dendmax + m_lineDiffInfos.back().end[pane];
+			if (rx >= GetImageWidth(pane))
+			{
+				if (clamp)
+					rx = GetImageWidth(pane) - 1;
+				inside = false;
+			}
+			return inside;
+		}
+	}
+
+	void CopySubImage(int pane, int x, int y, int x2, int y2, Image& image)
+	{
+		TemporaryTransformation tmp(*this);
+		m_imgOrig32[pane].copySubImage(image, x, y, x2, y2);
+	}
+
+	int GetLastErrorCode() const
+	{
+		return m_lastErrorCode;
+	}
+
+protected:
+	// Preprocesses and compares the images, leaving the diff images to the caller
+	void CompareImagesInternal()
+	{
+		const bool identical = PreprocessImages();
+		for (int i = 0; i < m_nImages; ++i)
+			m_imgPreprocessedIsTransparent[i] = m_imgPreprocessed[i].getFipImage()->isTransparent() ? true : false;
+
+		InitializeDiff();
+		if (identical)
+			m_diffCount = 0;
+		else if (m_nImages == 2)
+		{
+			CompareImages2(0, 1, m_diff);
+			m_diffCount = MarkDiffIndex(m_diff);
+		}
+		else if (m_nImages == 3)
+		{
+			CompareImages3();
+			Make3WayDiff(m_diff01, m_diff21, m_diff);
+			m_diffCount = MarkDiffIndex3way(m_diff01, m_diff21, m_diff02, m_diff);
+		}
+		if (m_currentDiffIndex >= m_diffCount)
+			m_currentDiffIndex = m_diffCount - 1;
+		m_diffMapCounts.clear();
+		m_diffMapValid = false;
+	}
+
+	// Compares the images again after the pixels of pane were edited, e.g. by CopyDiff or PasteImage.
+	// While the panes keep their sizes and offsets, only the tiles whose pixels or highlight
+	// changed in some pane are invalidated; the overlays and the wipe mix the panes, so a tile
+	// changed in one pane is invalidated in all of them.
+	void CompareEditedImages(int pane)
+	{
+		ImageModified(pane);
+		if (m_nImages <= 1)
+			return;
+		Image oldPreprocessed[3];
+		Point<unsigned> oldOffset[3];
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			oldPreprocessed[i].swap(m_imgPreprocessed[i]);
+			oldOffset[i] = m_offset[i];
+		}
+		const DiffBlocks oldDiff = m_diff;
+		const std::vector<DiffInfo> oldDiffInfos = m_diffInfos;
+		const int oldCurrentDiffIndex = m_currentDiffIndex;
+		const bool oldLineDiff = !m_lineDiffInfos.empty();
+
+		CompareImagesInternal();
+
+		// ghost lines move the rows of the panes, so an edit can change anything below it
+		const Size<unsigned> size = GetMaxWidthHeight();
+		bool sameLayout = !oldLineDiff && m_lineDiffInfos.empty() &&
+			m_tileComposed[0].size() == m_tileCountX * m_tileCountY;
+		for (int i = 0; i < m_nImages && sameLayout; ++i)
+		{
+			sameLayout = m_imgDiff[i].width() == size.cx && m_imgDiff[i].height() == size.cy &&
+				m_imgPreprocessed[i].width() == oldPreprocessed[i].width() &&
+				m_imgPreprocessed[i].height() == oldPreprocessed[i].height() &&
+				m_offset[i].x == oldOffset[i].x && m_offset[i].y == oldOffset[i].y;
+		}
+		if (!sameLayout)
+		{
+			RefreshImages();
+			return;
+		}
+
+		// the bounds of the changed pixels are kept per tile, so that hosts get rectangles
+		// smaller than the tiles to repaint
+		std::vector<Rect<int> > changed(m_tileCountX * m_tileCountY, Rect<int>(INT_MAX, INT_MAX, INT_MIN, INT_MIN));
+		for (int i = 0; i < m_nImages; ++i)
+			MarkChangedTiles(oldPreprocessed[i], m_imgPreprocessed[i], m_offset[i], changed);
+		if (m_showDifferences)
+			MarkChangedTiles(oldDiff, oldDiffInfos, oldCurrentDiffIndex, changed);
+		for (const auto& rc : changed)
+			InvalidateTiles(rc);
+		UpdateDiffTransparencyCache();
+		UpdateComposePassThrough();
+	}
+
+	// FreeImage keeps drawing its cached bitmap of a transparent image until it is marked as
+	// modified, so this has to be called whenever the pixels of a displayed image change
+	static void MarkImageModified(Image& image)
+	{
+		image.getFipImage()->setModified(true);
+	}
+
+	static void ExtendRect(Rect<int>& rc, int left, int top, int right, int bottom)
+	{
+		rc.left   = (std::min)(rc.left, left);
+		rc.top    = (std::min)(rc.top, top);
+		rc.right  = (std::max)(rc.right, right);
+		rc.bottom = (std::max)(rc.bottom, bottom);
+	}
+
+	// Extends the rectangles of the tiles of the diff image over the pixels of image that
+	// differ from oldImage. Both images have the same size and are placed at offset.
+	void MarkChangedTiles(const Image& oldImage, const Image& image, const Point<unsigned>& offset,
+		std::vector<Rect<int> >& changed) const
+	{
+		const unsigned w = image.width();
+		const unsigned h = image.height();
+		for (unsigned y = 0; y < h; ++y)
+		{
+			const unsigned char *scanline_old = oldImage.scanLine(y);
+			const unsigned char *scanline_new = image.scanLine(y);
+			Rect<int> *changedRow = &changed[((y + offset.y) / COMPOSE_TILE_SIZE) * m_tileCountX];
+			for (unsigned x = 0; x < w; )
+			{
+				const unsigned tx = (x + offset.x) / COMPOSE_TILE_SIZE;
+				const unsigned xend = (std::min)((tx + 1) * COMPOSE_TILE_SIZE - offset.x, w);
+				if (memcmp(scanline_old + x * 4, scanline_new + x * 4, (xend - x) * 4) != 0)
+				{
+					unsigned first = x, last = xend - 1;
+					while (memcmp(scanline_old + first * 4, scanline_new + first * 4, 4) == 0)
+						++first;
+					while (memcmp(scanline_old + last * 4, scanline_new + last * 4, 4) == 0)
+						--last;
+					ExtendRect(changedRow[tx], first + offset.x, y + offset.y, last + 1 + offset.x, y + 1 + offset.y);
+				}
+				x = xend;
+			}
+		}
+	}
+
+	// Extends the rectangles of the tiles of the diff image over the diff blocks that look
+	// different with oldDiff, i.e. that changed between different and not, in their op, or in
+	// whether they are selected.
+	void MarkChangedTiles(const DiffBlocks& oldDiff, const std::vector<DiffInfo>& oldDiffInfos,
+		int oldCurrentDiffIndex, std::vector<Rect<int> >& changed) const
+	{
+		auto appearance = [](const std::vector<DiffInfo>& diffInfos, int currentDiffIndex, int value)
+		{
+			if (value == 0)
+				return 0;
+			return (diffInfos[value - 1].op << 2) | ((value - 1 == currentDiffIndex) ? 2 : 0) | 1;
+		};
+		const unsigned bs = m_diffBlockSize;
+		const unsigned nBlocksX = static_cast<unsigned>(m_diff.width());
+		const unsigned nBlocksY = static_cast<unsigned>(m_diff.height());
+		std::vector<int> oldRow(nBlocksX), newRow(nBlocksX);
+		for (unsigned by = 0; by < nBlocksY; ++by)
+		{
+			oldDiff.getRow(by, oldRow.data());
+			m_diff.getRow(by, newRow.data());
+			const unsigned ty0 = (by * bs) / COMPOSE_TILE_SIZE;
+			const unsigned ty1 = (std::min)(((by + 1) * bs - 1) / COMPOSE_TILE_SIZE, m_tileCountY - 1);
+			for (unsigned bx = 0; bx < nBlocksX; ++bx)
+			{
+				if (appearance(oldDiffInfos, oldCurrentDiffIndex, oldRow[bx]) ==
+				    appearance(m_diffInfos, m_currentDiffIndex, newRow[bx]))
+					continue;
+				const unsigned tx0 = (bx * bs) / COMPOSE_TILE_SIZE;
+				const unsigned tx1 = (std::min)(((bx + 1) * bs - 1) / COMPOSE_TILE_SIZE, m_tileCountX - 1);
+				for (unsigned ty = ty0; ty <= ty1; ++ty)
+				{
+					for (unsigned tx = tx0; tx <= tx1; ++tx)
+					{
+						ExtendRect(changed[ty * m_tileCountX + tx],
+							(std::max)(bx * bs, tx * COMPOSE_TILE_SIZE), (std::max)(by * bs, ty * COMPOSE_TILE_SIZE),
+							(std::min)((bx + 1) * bs, (tx + 1) * COMPOSE_TILE_SIZE), (std::min)((by + 1) * bs, (ty + 1) * COMPOSE_TILE_SIZE));
+					}
+				}
+			}
+		}
+	}
+
+	// Builds the summed-area table of the diff blocks that differ, (width + 1) by (height + 1),
+	// so that GetDiffMapImage counts the blocks under a pixel of the map in constant time.
+	// The sums may wrap around, which still gives the exact count of any rectangle of blocks
+	// in unsigned arithmetic.
+	void BuildDiffMapCounts()
+	{
+		const unsigned nBlocksX = static_cast<unsigned>(m_diff.width());
+		const unsigned nBlocksY = static_cast<unsigned>(m_diff.height());
+		const size_t stride = nBlocksX + 1;
+		m_diffMapCounts.assign(stride * (nBlocksY + 1), 0);
+		for (unsigned by = 0; by < nBlocksY; ++by)
+		{
+			const unsigned *sumsAbove = &m_diffMapCounts[by * stride + 1];
+			unsigned *sums = &m_diffMapCounts[(by + 1) * stride + 1];
+			// the row is zero until here, so the differing blocks are marked first
+			for (const auto& run : m_diff.row(by))
+			{
+				if (run.value != 0)
+					std::fill(sums + run.x, sums + run.x + run.length, 1u);
+			}
+			unsigned sum = 0;
+			for (unsigned bx = 0; bx < nBlocksX; ++bx)
+			{
+				sum += sums[bx];
+				sums[bx] = sum + sumsAbove[bx];
+			}
+		}
+	}
+
+	// Builds the summed-area table of the blocks with value within rc in the same way
+	void BuildDiffMapCounts(int value, const Rect<int>& rc, std::vector<unsigned>& counts) const
+	{
+		const unsigned width = rc.right - rc.left;
+		const unsigned height = rc.bottom - rc.top;
+		const size_t stride = width + 1;
+		counts.assign(stride * (height + 1), 0);
+		for (unsigned y = 0; y < height; ++y)
+		{
+			unsigned *sums = &counts[(y + 1) * stride + 1];
+			const unsigned *sumsAbove = sums - stride;
+			for (const auto& run : m_diff.row(rc.top + y))
+			{
+				if (run.value != value)
+					continue;
+				const int left = (std::max)(static_cast<int>(run.x), rc.left);
+				const int right = (std::min)(static_cast<int>(run.x + run.length), rc.right);
+				for (int x = left; x < right; ++x)
+					sums[x - rc.left] = 1;
+			}
+			unsigned sum = 0;
+			for (unsigned x = 0; x < width; ++x)
+			{
+				sum += sums[x];
+				sums[x] = sum + sumsAbove[x];
+			}
+		}
+	}
+
+	// Records rc as changed in the image of pane for TakeDirtyRects. A rectangle covering the
+	// whole image replaces the others, and too many rectangles are merged into their bounds.
+	void AddDirtyRect(int pane, const Rect<int>& rc)
+	{
+		std::vector<Rect<int> >& rects = m_dirtyRects[pane];
+		const int w = static_cast<int>(m_imgDiff[pane].width());
+		const int h = static_cast<int>(m_imgDiff[pane].height());
+		const Rect<int> rcImage(0, 0, w, h);
+		if (rc.left >= rc.right || rc.top >= rc.bottom)
+			return;
+		if (rc.left <= 0 && rc.top <= 0 && rc.right >= w && rc.bottom >= h)
+		{
+			rects.assign(1, rcImage);
+			return;
+		}
+		if (!rects.empty() && rects[0].left == 0 && rects[0].top == 0 && rects[0].right == w && rects[0].bottom == h)
+			return;
+		if (rects.size() < MAX_DIRTY_RECTS)
+		{
+			rects.push_back(rc);
+			return;
+		}
+		Rect<int> bounds = rc;
+		for (const auto& r : rects)
+			ExtendRect(bounds, r.left, r.top, r.right, r.bottom);
+		rects.assign(1, bounds);
+	}
+
+	bool LoadImages()
+	{
+		int savedErrno = errno;
+		errno = 0;
+		bool bSucceeded = true;
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			m_imgConverter[i].close();
+			m_currentPage[i] = 0;
+			m_imgOrigMultiPage[i].load(m_filename[i]);
+			if (m_imgOrigMultiPage[i].isValid() && m_imgOrigMultiPage[i].getPageCount() > 1)
+			{
+				m_imgOrig[i] = m_imgOrigMultiPage[i].getImage(0);
+				m_imgOrig32[i] = m_imgOrig[i];
+			}
+			else
+			{
+				m_imgOrigMultiPage[i].close();
+				if (!m_imgOrig[i].load(m_filename[i]))
+				{
+					if (ImgConverter::isSupportedImage(m_filename[i].c_str()))
+					{
+						if (m_imgConverter[i].load(m_filename[i].c_str()))
+							m_imgConverter[i].render(m_imgOrig[i], 0, m_vectorImageZoomRatio);
+					}
+					if (!m_imgConverter[i].isValid() && !m_filename[i].empty())
+					{
+						bSucceeded = false;
+						m_lastErrorCode = (errno != 0) ? errno : ENOTSUP;
+					}
+				}
+				m_imgOrig32[i] = m_imgOrig[i];
+				std::map<std::string, std::string> meta = m_imgOrig[i].getMetadata();
+				m_horizontalFlip[i] = false;
+				m_verticalFlip[i] = false;
+				m_angle[i] = 0.f;
+				std::string orientation = meta["EXIF_MAIN/Orientation"];
+				if (orientation == "top, right side") // 2
+					m_horizontalFlip[i] = true;
+				else if (orientation == "bottom, right side") // 3
+					m_angle[i] = 180.f;
+				else if (orientation == "bottom, left side") // 4
+					m_verticalFlip[i] = true;
+				else if (orientation == "left side, top") // 5
+				{
+					m_angle[i] = 90.f;
+					m_verticalFlip[i] = true;
+				}
+				else if (orientation == "right side, top") // 6
+					m_angle[i] = 270.f;
+				else if (orientation == "right side, bottom") // 7
+				{
+					m_angle[i] = 270.f;
+					m_verticalFlip[i] = true;
+				}
+				else if (orientation == "left side, bottom") // 8
+					m_angle[i] = 90.f;
+			}
+			m_imgOrig32[i].convertTo32Bits();
+			ImageModified(i);
+		}
+		if (errno == 0)
+			errno = savedErrno;
+		return bSucceeded;
+	}
+
+	void ChangePage(int pane, int page)
+	{
+		if (m_imgOrigMultiPage[pane].isValid() || m_imgConverter[pane].isValid())
+		{
+			if (m_imgOrigMultiPage[pane].isValid())
+				m_imgOrig[pane] = m_imgOrigMultiPage[pane].getImage(page);
+			else
+				m_imgConverter[pane].render(m_imgOrig[pane], page, m_vectorImageZoomRatio);
+			m_imgOrig32[pane] = m_imgOrig[pane];
+			m_imgOrig32[pane].convertTo32Bits();
+			ImageModified(pane);
+			if (m_currentDiffIndex >= 0)
+				m_currentDiffIndex = 0;
+		}
+	}
+
+	Size<unsigned> GetMaxWidthHeight()
+	{
+		unsigned wmax = 0;
+		unsigned hmax = 0;
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			wmax = (std::max)(wmax, static_cast<unsigned>(m_imgPreprocessed[i].width())  + m_offset[i].x);
+			hmax = (std::max)(hmax, static_cast<unsigned>(m_imgPreprocessed[i].height()) + m_offset[i].y);
+		}
+		return Size<unsigned>(wmax, hmax);
+	}
+
+	bool AreImagesIdentical(const Image images[]) const
+	{
+		// offsets are normalized to a minimum of 0, so any offset leaves part of the canvas
+		// uncovered by some pane, which the compare marks as different
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			if (images[i].width() != images[0].width() || images[i].height() != images[0].height() ||
+				m_offset[i].x != 0 || m_offset[i].y != 0)
+				return false;
+		}
+
+		const int threshold2 = ImgDiffKernels::ColorDistanceThreshold2(m_colorDistanceThreshold);
+		const ImgDiffKernels::ColorDistanceWeights weights = GetEffectiveColorDistanceWeights();
+		// the same pairs whose differences make up the diff blocks in CompareImages
+		const int pairs[2][2] = { { 0, 1 }, { 2, 1 } };
+		const int npairs = m_nImages - 1;
+
+		const unsigned height = images[0].height();
+		const unsigned linesPerTask = 64;
+		std::atomic<bool> identical(true);
+		m_workerPool.ParallelFor((height + linesPerTask - 1) / linesPerTask,
+			[&](unsigned task)
+			{
+				const unsigned yend = (std::min)((task + 1) * linesPerTask, height);
+				for (unsigned y = task * linesPerTask; y < yend && identical; ++y)
+				{
+					for (int i = 0; i < npairs; ++i)
+					{
+						if (!alineEquals(images[pairs[i][0]], images[pairs[i][1]], y, y, threshold2, weights))
+						{
+							identical = false;
+							return;
+						}
+					}
+				}
+			});
+		return identical;
+	}
+
+	ImgDiffKernels::ColorDistanceWeights GetEffectiveColorDistanceWeights() const
+	{
+		ImgDiffKernels::ColorDistanceWeights weights = m_colorDistanceWeights;
+		if (m_ignoreAlphaDifferences)
+			weights.a = 0;
+		return weights;
+	}
+
+	void InitializeDiff()
+	{
+		Size<unsigned> size = GetMaxWidthHeight();
+		int nBlocksX = (size.cx + m_diffBlockSize - 1) / m_diffBlockSize;
+		int nBlocksY = (size.cy + m_diffBlockSize - 1) / m_diffBlockSize;
+
+		m_diff.clear();
+		m_diff.resize(nBlocksX, nBlocksY);
+		if (m_nImages == 3)
+		{
+			m_diff01.clear();
+			m_diff01.resize(nBlocksX, nBlocksY);
+			m_diff21.clear();
+			m_diff21.resize(nBlocksX, nBlocksY);
+			m_diff02.clear();
+			m_diff02.resize(nBlocksX, nBlocksY);
+		}
+		m_diffInfos.clear();
+	}
+
+	void InitializeDiffImages()
+	{
+		Size<unsigned> size = GetMaxWidthHeight();
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			// every tile is composited again anyway, so only a resize needs a new bitmap
+			if (m_imgDiff[i].width() != size.cx || m_imgDiff[i].height() != size.cy)
+				m_imgDiff[i].setSize(size.cx, size.cy);
+			// the back frame is only needed while blinking
+			if (!IsBlinking())
+				m_imgDiffBack[i].clear();
+			else if (m_imgDiffBack[i].width() != size.cx || m_imgDiffBack[i].height() != size.cy)
+				m_imgDiffBack[i].setSize(size.cx, size.cy);
+		}
+		m_tileCountX = (size.cx + COMPOSE_TILE_SIZE - 1) / COMPOSE_TILE_SIZE;
+		m_tileCountY = (size.cy + COMPOSE_TILE_SIZE - 1) / COMPOSE_TILE_SIZE;
+	}
+
+	void InvalidateTiles()
+	{
+		m_overlayFrames.clear();
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			m_tileComposed[i].assign(m_tileCountX * m_tileCountY, 0);
+			if (IsBlinking())
+				m_tileComposedBack[i].assign(m_tileCountX * m_tileCountY, 0);
+			else
+				m_tileComposedBack[i].clear();
+			InvalidateMipmaps(i, Rect<int>(0, 0, INT_MAX, INT_MAX));
+			if (!IsBlinking())
+				ClearMipmaps(m_mipmapsBack[i]);
+			AddDirtyRect(i, Rect<int>(0, 0, INT_MAX, INT_MAX));
+		}
+	}
+
+	// Invalidates the tiles of all panes that intersect the rectangle of the diff image
+	void InvalidateTiles(const Rect<int>& rc)
+	{
+		const int left   = (std::max)(rc.left, 0);
+		const int top    = (std::max)(rc.top, 0);
+		const int right  = (std::min)(rc.right, static_cast<int>(m_tileCountX * COMPOSE_TILE_SIZE));
+		const int bottom = (std::min)(rc.bottom, static_cast<int>(m_tileCountY * COMPOSE_TILE_SIZE));
+		if (left >= right || top >= bottom)
+			return;
+		std::vector<std::vector<unsigned char>*> tileComposed;
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			AddDirtyRect(i, Rect<int>(left, top,
+				(std::min)(right, static_cast<int>(m_imgDiff[i].width())),
+				(std::min)(bottom, static_cast<int>(m_imgDiff[i].height()))));
+			InvalidateMipmaps(i, Rect<int>(left, top, right, bottom));
+			tileComposed.push_back(&m_tileComposed[i]);
+			tileComposed.push_back(&m_tileComposedBack[i]);
+			for (auto& frame : m_overlayFrames)
+				tileComposed.push_back(&frame.tileComposed[i]);
+		}
+		for (std::vector<unsigned char>* composed : tileComposed)
+		{
+			if (composed->empty())
+				continue;
+			for (unsigned ty = top / COMPOSE_TILE_SIZE; ty <= static_cast<unsigned>(bottom - 1) / COMPOSE_TILE_SIZE; ++ty)
+				for (unsigned tx = left / COMPOSE_TILE_SIZE; tx <= static_cast<unsigned>(right - 1) / COMPOSE_TILE_SIZE; ++tx)
+					(*composed)[ty * m_tileCountX + tx] = 0;
+		}
+	}
+
+	// A level of the mipmap pyramid of a pane, with a flag for each of its tiles of
+	// COMPOSE_TILE_SIZE pixels telling whether it has been reduced from the level below
+	struct MipmapLevel
+	{
+		Image image;
+		std::vector<unsigned char> tileReduced;
+	};
+
+	static void ClearMipmaps(MipmapLevel (&mipmaps)[MAX_MIPMAP_LEVEL])
+	{
+		for (MipmapLevel& mip : mipmaps)
+		{
+			mip.image.clear();
+			mip.tileReduced.clear();
+		}
+	}
+
+	// Swaps the levels one by one, since Image copies its bitmap when moved
+	static void SwapMipmaps(MipmapLevel (&mipmaps1)[MAX_MIPMAP_LEVEL], MipmapLevel (&mipmaps2)[MAX_MIPMAP_LEVEL])
+	{
+		for (int level = 0; level < MAX_MIPMAP_LEVEL; ++level)
+		{
+			mipmaps1[level].image.swap(mipmaps2[level].image);
+			mipmaps1[level].tileReduced.swap(mipmaps2[level].tileReduced);
+		}
+	}
+
+	// Invalidates the tiles of the mipmap pyramids of pane, of both blink frames and of the
+	// cached overlay frames, that are reduced from the rectangle of the diff image
+	void InvalidateMipmaps(int pane, const Rect<int>& rc)
+	{
+		std::vector<MipmapLevel (*)[MAX_MIPMAP_LEVEL]> pyramids{ &m_mipmaps[pane], &m_mipmapsBack[pane] };
+		for (auto& frame : m_overlayFrames)
+			pyramids.push_back(&frame.mipmaps[pane]);
+		for (MipmapLevel (*mipmaps)[MAX_MIPMAP_LEVEL] : pyramids)
+		{
+			for (int level = 1; level <= MAX_MIPMAP_LEVEL; ++level)
+			{
+				MipmapLevel& mip = (*mipmaps)[level - 1];
+				if (mip.tileReduced.empty())
+					continue;
+				const int64_t scale = int64_t(1) << level;
+				const unsigned width = mip.image.width(), height = mip.image.height();
+				const unsigned left   = static_cast<unsigned>((std::max)(rc.left, 0) / scale);
+				const unsigned top    = static_cast<unsigned>((std::max)(rc.top, 0) / scale);
+				const unsigned right  = static_cast<unsigned>((std::min)((rc.right + scale - 1) / scale, int64_t(width)));
+				const unsigned bottom = static_cast<unsigned>((std::min)((rc.bottom + scale - 1) / scale, int64_t(height)));
+				if (left >= right || top >= bottom)
+					continue;
+				const unsigned tileCountX = (width + COMPOSE_TILE_SIZE - 1) / COMPOSE_TILE_SIZE;
+				for (unsigned ty = top / COMPOSE_TILE_SIZE; ty <= (bottom - 1) / COMPOSE_TILE_SIZE; ++ty)
+					for (unsigned tx = left / COMPOSE_TILE_SIZE; tx <= (right - 1) / COMPOSE_TILE_SIZE; ++tx)
+						mip.tileReduced[ty * tileCountX + tx] = 0;
+			}
+		}
+	}
+
+	// Reduces the tiles of a level of the mipmap pyramid of pane, or of the one of the back blink
+	// frame, that intersect the rectangle in coordinates of that level and are not reduced yet.
+	// The level below is prepared first under those tiles, down to the diff image at level 0.
+	void ReduceMipmapRect(int pane, int level, int left, int top, int right, int bottom, bool back = false)
+	{
+		if (level == 0)
+		{
+			if (!IsComposePassThrough(pane, back ? !m_composeShowDiff : m_composeShowDiff))
+				ComposeTiles(pane, left, top, right, bottom, back);
+			return;
+		}
+		MipmapLevel (&mipmaps)[MAX_MIPMAP_LEVEL] = back ? m_mipmapsBack[pane] : m_mipmaps[pane];
+		const Image& src = (level == 1) ? GetFrameImage(pane, back) : mipmaps[level - 2].image;
+		MipmapLevel& mip = mipmaps[level - 1];
+		// the levels below may not have been resized yet
+		unsigned width = GetFrameImage(pane, back).width(), height = GetFrameImage(pane, back).height();
+		for (int i = 0; i < level; ++i)
+		{
+			width = (width + 1) / 2;
+			height = (height + 1) / 2;
+		}
+		const unsigned tileCountX = (width + COMPOSE_TILE_SIZE - 1) / COMPOSE_TILE_SIZE;
+		const unsigned tileCountY = (height + COMPOSE_TILE_SIZE - 1) / COMPOSE_TILE_SIZE;
+		if (mip.image.width() != width || mip.image.height() != height || mip.tileReduced.size() != tileCountX * tileCountY)
+		{
+			mip.image.setSize(width, height);
+			mip.tileReduced.assign(tileCountX * tileCountY, 0);
+		}
+		left   = (std::max)(left, 0);
+		top    = (std::max)(top, 0);
+		right  = (std::min)(right, static_cast<int>(width));
+		bottom = (std::min)(bottom, static_cast<int>(height));
+		if (left >= right || top >= bottom)
+			return;
+		std::vector<unsigned> tiles;
+		Rect<int> rcTiles(INT_MAX, INT_MAX, INT_MIN, INT_MIN);
+		for (unsigned ty = top / COMPOSE_TILE_SIZE; ty <= static_cast<unsigned>(bottom - 1) / COMPOSE_TILE_SIZE; ++ty)
+		{
+			for (unsigned tx = left / COMPOSE_TILE_SIZE; tx <= static_cast<unsigned>(right - 1) / COMPOSE_TILE_SIZE; ++tx)
+			{
+				const unsigned tile = ty * tileCountX + tx;
+				if (!mip.tileReduced[tile])
+				{
+					mip.tileReduced[tile] = 1;
+					tiles.push_back(tile);
+					ExtendRect(rcTiles, tx * COMPOSE_TILE_SIZE, ty * COMPOSE_TILE_SIZE,
+						(tx + 1) * COMPOSE_TILE_SIZE, (ty + 1) * COMPOSE_TILE_SIZE);
+				}
+			}
+		}
+		if (tiles.empty())
+			return;
+		ReduceMipmapRect(pane, level - 1, rcTiles.left * 2, rcTiles.top * 2, rcTiles.right * 2, rcTiles.bottom * 2, back);
+		// tiles do not overlap, so they can be reduced in any order
+		m_workerPool.ParallelFor(static_cast<unsigned>(tiles.size()),
+			[&](unsigned i)
+			{
+				const unsigned tx = tiles[i] % tileCountX, ty = tiles[i] / tileCountX;
+				ReduceRect(src, mip.image, Rect<unsigned>(tx * COMPOSE_TILE_SIZE, ty * COMPOSE_TILE_SIZE,
+					(std::min)((tx + 1) * COMPOSE_TILE_SIZE, width), (std::min)((ty + 1) * COMPOSE_TILE_SIZE, height)));
+			});
+		MarkImageModified(mip.image);
+	}
+
+	// The full size image a mipmap pyramid is reduced from: the image GetDisplayImage returns,
+	// or the back blink frame, which is the preprocessed image as well when nothing is
+	// composited over it
+	const Image& GetFrameImage(int pane, bool back) const
+	{
+		if (!back)
+			return m_composePassThrough[pane] ? m_imgPreprocessed[pane] : m_imgDiff[pane];
+		return IsComposePassThrough(pane, !m_composeShowDiff) ? m_imgPreprocessed[pane] : m_imgDiffBack[pane];
+	}
+
+	// Scales the rectangle of dst down from src, which is twice as large rounded up, with a 2x2
+	// box filter. The last column and row of an odd sized src stand for two.
+	static void ReduceRect(const Image& src, Image& dst, const Rect<unsigned>& rc)
+	{
+		const ImgDiffKernels::ReduceHalfFunc reduceHalf = ImgDiffKernels::GetKernels().reduceHalf;
+		const unsigned srcHeight = src.height();
+		// the pixels of dst that have two columns of src under them
+		const unsigned right = (std::min)(rc.right, src.width() / 2);
+		for (unsigned y = rc.top; y < rc.bottom; ++y)
+		{
+			const unsigned char *scanline_src0 = src.scanLine(2 * y);
+			const unsigned char *scanline_src1 = src.scanLine((std::min)(2 * y + 1, srcHeight - 1));
+			unsigned char *scanline_dst = dst.scanLine(y);
+			if (rc.left < right)
+				reduceHalf(scanline_dst + rc.left * 4, scanline_src0 + rc.left * 8, scanline_src1 + rc.left * 8, right - rc.left);
+			for (unsigned x = (std::max)(rc.left, right); x < rc.right; ++x)
+			{
+				for (unsigned c = 0; c < 4; ++c)
+					scanline_dst[x * 4 + c] = static_cast<unsigned char>((scanline_src0[x * 8 + c] + scanline_src1[x * 8 + c] + 1) >> 1);
+			}
+		}
+	}
+
+	// A frame composited with an alpha of the animated overlay, kept for the next time the
+	// animation comes back to that alpha. Only the tiles that were shown are composited, and
+	// only the tiles of the mipmap levels that were shown are reduced.
+	struct OverlayFrame
+	{
+		double overlayAlpha;
+		bool showDiff;
+		Image images[3];
+		std::vector<unsigned char> tileComposed[3];
+		MipmapLevel mipmaps[3][MAX_MIPMAP_LEVEL];
+	};
+
+	// Replaces the frame in images and its mipmap pyramids, composited with the current overlay
+	// alpha and the highlight shown if showDiff, with the frame of overlayAlpha and newShowDiff.
+	// The frame left is kept in the cache while the cache size allows it, and the frame entered
+	// is taken from there if it was kept. Otherwise all its tiles have to be composited and
+	// reduced again. The cache size is in bytes and counts every level of the pyramids, so
+	// large images keep fewer frames, or none when one frame does not fit.
+	void ExchangeOverlayFrame(Image images[], std::vector<unsigned char> tileComposed[],
+		MipmapLevel (*mipmaps)[MAX_MIPMAP_LEVEL], bool showDiff, double overlayAlpha, bool newShowDiff)
+	{
+		const Size<unsigned> size = GetMaxWidthHeight();
+		size_t paneBytes = 0;
+		for (unsigned level = 0, w = size.cx, h = size.cy; level <= MAX_MIPMAP_LEVEL; ++level, w = (w + 1) / 2, h = (h + 1) / 2)
+			paneBytes += static_cast<size_t>(w) * h * 4;
+		const size_t frameBytes = paneBytes * m_nImages;
+		const size_t cacheBytes = m_overlayAnimationSteps > 0 ?
+			static_cast<size_t>((std::max)(m_overlayAnimationCacheSize, 0)) * 1024 * 1024 : 0;
+		auto it = std::find_if(m_overlayFrames.begin(), m_overlayFrames.end(),
+			[&](const OverlayFrame& frame) { return frame.overlayAlpha == overlayAlpha && frame.showDiff == newShowDiff; });
+		const bool cached = (it != m_overlayFrames.end());
+		if (!cached && frameBytes > 0 && (m_overlayFrames.size() + 1) * frameBytes <= cacheBytes)
+			it = m_overlayFrames.emplace(m_overlayFrames.end());
+		for (int i = 0; i < m_nImages; ++i)
+		{
+			if (it != m_overlayFrames.end())
+			{
+				images[i].swap(it->images[i]);
+				tileComposed[i].swap(it->tileComposed[i]);
+				SwapMipmaps(mipmaps[i], it->mipmaps[i]);
+			}
+			if (!cached)
+			{
+				if (images[i].width() != size.cx || images[i].height() != size.cy)
+					images[i].setSize(size.cx, size.cy);
+				tileComposed[i].assign(m_tileCountX * m_tileCountY, 0);
+				for (MipmapLevel& mip : mipmaps[i])
+					std::fill(mip.tileReduced.begin(), mip.tileReduced.end(), 0);
+			}
+			MarkImageModified(images[i]);
+			for (MipmapLevel& mip : mipmaps[i])
+			{
+				if (!mip.tileReduced.empty())
+					MarkImageModified(mip.image);
+			}
+		}
+		if (it != m_overlayFrames.end())
+		{
+			it->overlayAlpha = m_composeOverlayAlpha;
+			it->showDiff = showDiff;
+		}
+	}
+
+	// Whether the highlight is shown in the current frame, which changes over time while blinking
+	bool GetCurrentShowDiff() const
+	{
+		if (!m_showDifferences)
+			return false;
+		if (!m_blinkDifferences)
+			return true;
+		auto now = std::chrono::system_clock::now();
+		auto tse = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
+		return (tse.count() % m_blinkInterval) >= m_blinkInterval / 2;
+	}
+
+	// The alpha of the overlay for the current frame, which changes over time with OVERLAY_ALPHABLEND_ANIM
+	double GetCurrentOverlayAlpha() const
+	{
+		double overlayAlpha = m_overlayAlpha;
+		if (m_overlayMode == OVERLAY_ALPHABLEND_ANIM)
+		{
+			auto now = std::chrono::system_clock::now();
+			auto tse = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
+			double t = static_cast<double>(tse.count() % m_overlayAnimationInterval);
+			if (t < m_overlayAnimationInterval * 2 / 10)
+				overlayAlpha = t / (m_overlayAnimationInterval * 2 / 10);
+			else if (t < m_overlayAnimationInterval * 5 / 10)
+				overlayAlpha = 1.0;
+			else if (t < m_overlayAnimationInterval * 7 / 10)
+				overlayAlpha = ((m_overlayAnimationInterval * 2 / 10) - (t - (m_overlayAnimationInterval * 5 / 10)))
+				              / (m_overlayAnimationInterval * 2 / 10);
+			else
+				overlayAlpha = 0.0;
+			// a few steps give the same smooth ramp, and let the frames of every step be cached
+			if (m_overlayAnimationSteps > 0)
+				overlayAlpha = static_cast<int>(overlayAlpha * m_overlayAnimationSteps + 0.5) / static_cast<double>(m_overlayAnimationSteps);
+		}
+		return overlayAlpha;
+	}
+
+	void ClampWipePosition()
+	{
+		if (m_wipePosition <= 0)
+			m_wipePosition = 0;
+		if (m_wipeMode == WIPE_VERTICAL && m_wipePosition >= static_cast<int>(m_imgDiff[0].height()))
+			m_wipePosition = m_imgDiff[0].height();
+		else if (m_wipeMode == WIPE_HORIZONTAL && m_wipePosition >= static_cast<int>(m_imgDiff[0].width()))
+			m_wipePosition = m_imgDiff[0].width();
+	}
+
+	void ComposeTile(int pane, unsigned tx, unsigned ty, Image& dst, bool markDiff) const
+	{
+		const unsigned w = dst.width();
+		const unsigned h = dst.height();
+		Rect<unsigned> rc(tx * COMPOSE_TILE_SIZE, ty * COMPOSE_TILE_SIZE,
+			(std::min)((tx + 1) * COMPOSE_TILE_SIZE, w), (std::min)((ty + 1) * COMPOSE_TILE_SIZE, h));
+		if (m_wipeMode == WIPE_NONE)
+		{
+			ComposeLayers(pane, rc, dst, markDiff);
+			return;
+		}
+		// past the wipe position every pane shows the next one
+		const unsigned wipePosition = static_cast<unsigned>(m_wipePosition);
+		Rect<unsigned> rcWiped = rc;
+		if (m_wipeMode == WIPE_VERTICAL)
+		{
+			rc.bottom = (std::max)(rc.top, (std::min)(wipePosition, rc.bottom));
+			rcWiped.top = rc.bottom;
+		}
+		else
+		{
+			rc.right = (std::max)(rc.left, (std::min)(wipePosition, rc.right));
+			rcWiped.left = rc.right;
+		}
+		ComposeLayers(pane, rc, dst, markDiff);
+		ComposeLayers((pane + 1) % m_nImages, rcWiped, dst, markDiff);
+	}
+
+	// Writes the rectangle of the composited image of pane to dst: the preprocessed image,
+	// the overlay of the neighbouring panes, then the diff highlight.
+	void ComposeLayers(int pane, const Rect<unsigned>& rc, Image& dst, bool markDiff) const
+	{
+		if (rc.left >= rc.right || rc.top >= rc.bottom)
+			return;
+		CopyPreprocessedImageToDiffImage(pane, rc, dst);
+		void (CImgDiffBuffer::*func)(int src, const Rect<unsigned>& rc, Image& dst) const = NULL;
+		if (m_overlayMode == OVERLAY_ALPHABLEND || m_overlayMode == OVERLAY_ALPHABLEND_ANIM)
+			func = &CImgDiffBuffer::AlphaBlendImages2;
+		else if (m_overlayMode == OVERLAY_XOR)
+			func = &CImgDiffBuffer::XorImages2;
+		if (func)
+		{
+			for (int src = pane - 1; src <= pane + 1; src += 2)
+			{
+				if (src >= 0 && src < m_nImages)
+					(this->*func)(src, rc, dst);
+			}
+		}
+		if (markDiff)
+			MarkDiff(pane, m_diff, rc, dst);
+	}
+
+	void CompareImages2(int pane1, int pane2, DiffBlocks& diff)
+	{
+		const BlockRowCompare cmp = PrepareBlockRowCompare(pane1, pane2, static_cast<unsigned>(diff.width()));
+		// every block row only writes its own row of diff, so rows can be compared in any order
+		m_workerPool.ParallelFor(static_cast<unsigned>(diff.height()),
+			[&](unsigned by)
+			{
+				std::vector<int> blocks(cmp.nblocks);
+				(this->*cmp.compareBlockRow)(cmp, by, blocks.data());
+				diff.setRow(by, blocks.data());
+			});
+	}
+
+	void CompareImages3()
+	{
+		const BlockRowCompare cmp01 = PrepareBlockRowCompare(0, 1, static_cast<unsigned>(m_diff01.width()));
+		const BlockRowCompare cmp21 = PrepareBlockRowCompare(2, 1, static_cast<unsigned>(m_diff21.width()));
+		const BlockRowCompare cmp02 = PrepareBlockRowCompare(0, 2, static_cast<unsigned>(m_diff02.width()));
+		// compare the three pairs block row by block row so that the scanlines of each pane
+		// are still in cache when the next pair reads them
+		m_workerPool.ParallelFor(static_cast<unsigned>(m_diff01.height()),
+			[&](unsigned by)
+			{
+				std::vector<int> blocks(cmp01.nblocks);
+				(this->*cmp01.compareBlockRow)(cmp01, by, blocks.data());
+				m_diff01.setRow(by, blocks.data());
+				std::fill(blocks.begin(), blocks.end(), 0);
+				(this->*cmp21.compareBlockRow)(cmp21, by, blocks.data());
+				m_diff21.setRow(by, blocks.data());
+				std::fill(blocks.begin(), blocks.end(), 0);
+				(this->*cmp02.compareBlockRow)(cmp02, by, blocks.data());
+				m_diff02.setRow(by, blocks.data());
+			});
+	}
+
+	struct BlockRowCompare
+	{
+		int pane1, pane2;
+		unsigned x1min, y1min, x1max, y1max;
+		unsigned x2min, y2min, x2max, y2max;
+		unsigned wmax, hmax;
+		unsigned xmin, xmax; // overlapping columns of both images
+		unsigned nblocks;    // blocks per row
+		int threshold2;
+		ImgDiffKernels::ColorDistanceWeights weights;
+		ImgDiffKernels::MarkDiffBlocksExactFunc markDiffBlocksExact;
+		ImgDiffKernels::MarkDiffBlocksThresholdFunc markDiffBlocksThreshold;
+		ImgDiffKernels::EqualsThresholdFunc equalsThreshold;
+		bool compareBlockSpans;
+		void (CImgDiffBuffer::*compareBlockRow)(const BlockRowCompare& cmp, unsigned by, int *blocks) const;
+	};
+
+	// Computes everything that is constant over the compare of two panes and selects
+	// the specialization of CompareBlockRow and the kernels to use.
+	BlockRowCompare PrepareBlockRowCompare(int pane1, int pane2, unsigned nblocks) const
+	{
+		BlockRowCompare cmp;
+		cmp.pane1 = pane1;
+		cmp.pane2 = pane2;
+		cmp.x1min = m_imgPreprocessed[pane1].width()  > 0 ? m_offset[pane1].x : -1;
+		cmp.y1min = m_imgPreprocessed[pane1].height() > 0 ? m_offset[pane1].y : -1;
+		cmp.x2min = m_imgPreprocessed[pane2].width()  > 0 ? m_offset[pane2].x : -1;
+		cmp.y2min = m_imgPreprocessed[pane2].height() > 0 ? m_offset[pane2].y : -1;
+		cmp.x1max = cmp.x1min + m_imgPreprocessed[pane1].width() - 1;
+		cmp.y1max = cmp.y1min + m_imgPreprocessed[pane1].height() - 1;
+		cmp.x2max = cmp.x2min + m_imgPreprocessed[pane2].width() - 1;
+		cmp.y2max = cmp.y2min + m_imgPreprocessed[pane2].height() - 1;
+		cmp.wmax = (std::min)((std::max)(cmp.x1max + 1, cmp.x2max + 1), nblocks * m_diffBlockSize);
+		cmp.hmax = (std::max)(cmp.y1max + 1, cmp.y2max + 1);
+		cmp.xmin = (std::max)(cmp.x1min, cmp.x2min);
+		cmp.xmax = (std::min)(cmp.x1max, cmp.x2max);
+		cmp.nblocks = nblocks;
+
+		const ImgDiffKernels::Kernels& kernels = ImgDiffKernels::GetKernels();
+		const bool pow2 = ImgDiffKernels::IsPowerOfTwo(m_diffBlockSize);
+		cmp.markDiffBlocksExact = pow2 ? kernels.markDiffBlocksExactPow2 : kernels.markDiffBlocksExact;
+		cmp.markDiffBlocksThreshold = pow2 ? kernels.markDiffBlocksThresholdPow2 : kernels.markDiffBlocksThreshold;
+		cmp.equalsThreshold = kernels.equalsThreshold;
+		cmp.threshold2 = ImgDiffKernels::ColorDistanceThreshold2(m_colorDistanceThreshold);
+		cmp.weights = GetEffectiveColorDistanceWeights();
+		// with blocks narrower than a SIMD register, comparing block by block costs more than it saves
+		cmp.compareBlockSpans = m_diffBlockSize >= MIN_BLOCK_SIZE_FOR_SPAN_COMPARE;
+
+		const bool aligned = cmp.x1min == cmp.x2min && cmp.x1max == cmp.x2max;
+		const bool threshold = !ImgDiffKernels::IsExactCompare(cmp.threshold2, cmp.weights);
+		if (aligned)
+			cmp.compareBlockRow = threshold ? &CImgDiffBuffer::CompareBlockRow<true, true> : &CImgDiffBuffer::CompareBlockRow<true, false>;
+		else
+			cmp.compareBlockRow = threshold ? &CImgDiffBuffer::CompareBlockRow<false, true> : &CImgDiffBuffer::CompareBlockRow<false, false>;
+		return cmp;
+	}
+
+	// Sets the blocks of block row by that differ to -1. Aligned: both images cover the same
+	// columns. Threshold: compare by color distance instead of bytes.
+	template<bool Aligned, bool Threshold>
+	void CompareBlockRow(const BlockRowCompare& cmp, unsigned by, int *blocks) const
+	{
+		unsigned bsy = (cmp.hmax - by * m_diffBlockSize) >= m_diffBlockSize ? m_diffBlockSize : (cmp.hmax - by * m_diffBlockSize); 
+		for (unsigned i = 0; i < bsy; ++i)
+		{
+			// once every block of the row is known to differ, the remaining lines cannot change anything
+			if (i > 0 && std::find(blocks, blocks + cmp.nblocks, 0) == blocks + cmp.nblocks)
+				break;
+			unsigned y = by * m_diffBlockSize + i;
+			if (y < cmp.y1min || y > cmp.y1max || y < cmp.y2min || y > cmp.y2max)
+			{
+				std::fill(blocks, blocks + cmp.nblocks, -1);
+				continue;
+			}
+			const unsigned char *scanline1 = m_imgPreprocessed[cmp.pane1].scanLine(y - cmp.y1min);
+			const unsigned char *scanline2 = m_imgPreprocessed[cmp.pane2].scanLine(y - cmp.y2min);
+			if (Aligned && !Threshold)
+			{
+				if (memcmp(scanline1, scanline2, (cmp.x1max + 1 - cmp.x1min) * 4) == 0)
+					continue;
+			}
+			if (!Aligned && cmp.xmin > cmp.xmax)
+			{
+				MarkDiffBlocks(0, cmp.wmax, blocks);
+				continue;
+			}
+			MarkDiffBlocks(0, cmp.xmin, blocks);
+			MarkDiffBlocks(cmp.xmax + 1, cmp.wmax, blocks);
+			if (cmp.compareBlockSpans)
+				CompareBlockSpans<Threshold>(cmp, scanline1, scanline2, blocks);
+			else if (Threshold)
+				cmp.markDiffBlocksThreshold(scanline1 + (cmp.xmin - cmp.x1min) * 4, scanline2 + (cmp.xmin - cmp.x2min) * 4,
+					cmp.xmax + 1 - cmp.xmin, cmp.xmin, m_diffBlockSize, blocks, cmp.threshold2, cmp.weights);
+			else
+				cmp.markDiffBlocksExact(scanline1 + (cmp.xmin - cmp.x1min) * 4, scanline2 + (cmp.xmin - cmp.x2min) * 4,
+					cmp.xmax + 1 - cmp.xmin, cmp.xmin, m_diffBlockSize, blocks);
+		}
+	}
+
+	// Compares the overlapping columns block by block, skipping blocks that are already known
+	// to differ and stopping inside a block at its first differing pixel.
+	template<bool Threshold>
+	void CompareBlockSpans(const BlockRowCompare& cmp, const unsigned char *scanline1, const unsigned char *scanline2, int *blocks) const
+	{
+		for (unsigned bx = cmp.xmin / m_diffBlockSize; bx <= cmp.xmax / m_diffBlockSize; ++bx)
+		{
+			if (blocks[bx] == -1)
+				continue;
+			const unsigned xbegin = (std::max)(bx * m_diffBlockSize, cmp.xmin);
+			const unsigned xend = (std::min)((bx + 1) * m_diffBlockSize, cmp.xmax + 1);
+			const unsigned char *p1 = scanline1 + (xbegin - cmp.x1min) * 4;
+			const unsigned char *p2 = scanline2 + (xbegin - cmp.x2min) * 4;
+			const bool equal = Threshold ?
+				cmp.equalsThreshold(p1, p2, xend - xbegin, cmp.threshold2, cmp.weights) :
+				memcmp(p1, p2, (xend - xbegin) * 4) == 0;
+			if (!equal)
+				blocks[bx] = -1;
+		}
+	}
+
+	void MarkDiffBlocks(unsigned xbegin, unsigned xend, int *blocks) const
+	{
+		if (xbegin >= xend)
+			return;
+		for (unsigned bx = xbegin / m_diffBlockSize; bx <= (xend - 1) / m_diffBlockSize; ++bx)
+			blocks[bx] = -1;
+	}
+		
+	// A horizontal strip of the diff block array labeled independently by MarkDiffIndex
+	struct LabelStrip
+	{
+		unsigned top, bottom;
+		int offset;                      // added to the strip's labels to make them unique over all strips
+		std::vector<int> parent;         // union-find forest of the strip's provisional labels, [0] unused
+		std::vector<Rect<int> > bounds;  // bounding box of each provisional label
+	};
+
+	// Gives each 8-connected region of -1 blocks its own index, numbered in the order
+	// in which the regions are first met in a row by row scan, and adds a DiffInfo for it.
+	// Strips of rows are labeled in parallel and the labels touching the strip borders
+	// are merged afterwards. Every region gets the smallest label that was assigned to it,
+	// which is the one of its first run, so the result does not depend on the strips.
+	int MarkDiffIndex(DiffBlocks& diff)
+	{
+		const unsigned height = static_cast<unsigned>(diff.height());
+		const unsigned nstrips = (std::max)(GetWorkerThreadCount(m_compareThreadCount, height), 1u);
+		std::vector<LabelStrip> strips(nstrips);
+		for (unsigned s = 0; s < nstrips; ++s)
+		{
+			strips[s].top = height * s / nstrips;
+			strips[s].bottom = height * (s + 1) / nstrips;
+		}
+
+		// first pass: provisional labels and their equivalences within each strip
+		m_workerPool.ParallelFor(nstrips, [&](unsigned s) { LabelStripRuns(diff, strips[s]); });
+
+		int nlabels = 0;
+		for (auto& strip : strips)
+		{
+			strip.offset = nlabels;
+			nlabels += static_cast<int>(strip.parent.size()) - 1;
+		}
+		std::vector<int> parent(nlabels + 1);
+		for (auto& strip : strips)
+		{
+			for (size_t i = 1; i < strip.parent.size(); ++i)
+				parent[strip.offset + i] = strip.offset + strip.parent[i];
+		}
+
+		// merge the regions crossing the strip borders
+		for (unsigned s = 1; s < nstrips; ++s)
+		{
+			const unsigned y = strips[s].top;
+			if (y == 0 || y >= height)
+				continue;
+			size_t first = 0;
+			for (const auto& run : diff.row(y))
+			{
+				ForEachTouchingRun(diff.row(y - 1), run, first, [&](const DiffBlocks::Run& upper)
+					{
+						UnionLabels(parent, strips[s].offset + run.value, strips[s - 1].offset + upper.value);
+					});
+			}
+		}
+
+		// every root label is the first label of its region, so numbering the roots in order
+		// numbers the regions in scan order
+		std::vector<int> diffIndex(nlabels + 1);
+		int diffCount = 0;
+		for (int label = 1; label <= nlabels; ++label)
+		{
+			const int root = FindRootLabel(parent, label);
+			diffIndex[label] = (root == label) ? ++diffCount : diffIndex[root];
+		}
+
+		// second pass: final indices
+		m_workerPool.ParallelFor(nstrips,
+			[&](unsigned s)
+			{
+				LabelStrip& strip = strips[s];
+				for (unsigned y = strip.top; y < strip.bottom; ++y)
+				{
+					for (auto& run : diff.row(y))
+						run.value = diffIndex[strip.offset + run.value];
+				}
+			});
+
+		const size_t first = m_diffInfos.size();
+		for (int i = 0; i < diffCount; ++i)
+			m_diffInfos.push_back(DiffInfo(OP_DIFF, 0, 0));
+		std::vector<bool> initialized(diffCount);
+		for (auto& strip : strips)
+		{
+			for (size_t i = 1; i < strip.bounds.size(); ++i)
+			{
+				const int index = diffIndex[strip.offset + i] - 1;
+				Rect<int>& rc = m_diffInfos[first + index].rc;
+				const Rect<int>& bounds = strip.bounds[i];
+				if (!initialized[index])
+				{
+					rc = bounds;
+					initialized[index] = true;
+					continue;
+				}
+				rc.left   = (std::min)(rc.left, bounds.left);
+				rc.top    = (std::min)(rc.top, bounds.top);
+				rc.right  = (std::max)(rc.right, bounds.right);
+				rc.bottom = (std::max)(rc.bottom, bounds.bottom);
+			}
+		}
+		return diffCount;
+	}
+
+	// Calls func for every run of the upper row that touches run of the row below it, diagonally
+	// included. first is the index of the first upper run that can still touch run or a later
+	// run of the same row.
+	template<class Func>
+	static void ForEachTouchingRun(const DiffBlocks::Row& upper, const DiffBlocks::Run& run, size_t& first, Func func)
+	{
+		while (first < upper.size() && upper[first].x + upper[first].length < run.x)
+			++first;
+		for (size_t i = first; i < upper.size() && upper[i].x <= run.x + run.length; ++i)
+			func(upper[i]);
+	}
+
+	// Scanline labeling of the runs of one strip: assigns provisional labels to the runs,
+	// records which labels touch and the bounding box of each label.
+	void LabelStripRuns(DiffBlocks& diff, LabelStrip& strip) const
+	{
+		strip.parent.assign(1, 0);
+		strip.bounds.assign(1, Rect<int>(0, 0, 0, 0));
+		for (unsigned y = strip.top; y < strip.bottom; ++y)
+		{
+			size_t first = 0;
+			for (auto& run : diff.row(y))
+			{
+				int label = 0;
+				if (y > strip.top)
+				{
+					ForEachTouchingRun(diff.row(y - 1), run, first, [&](const DiffBlocks::Run& upper)
+						{
+							if (label == 0)
+								label = upper.value;
+							else if (upper.value != label)
+								UnionLabels(strip.parent, label, upper.value);
+						});
+				}
+				const int left = static_cast<int>(run.x);
+				const int right = static_cast<int>(run.x + run.length);
+				if (label == 0)
+				{
+					label = static_cast<int>(strip.parent.size());
+					strip.parent.push_back(label);
+					strip.bounds.push_back(Rect<int>(left, y, right, y + 1));
+				}
+				else
+				{
+					Rect<int>& rc = strip.bounds[label];
+					rc.left   = (std::min)(rc.left, left);
+					rc.right  = (std::max)(rc.right, right);
+					rc.bottom = static_cast<int>(y + 1);
+				}
+				run.value = label;
+			}
+		}
+	}
+
+	int MarkDiffIndex3way(const DiffMask& diff01, const DiffMask& diff21, const DiffMask& diff02, DiffBlocks& diff3)
+	{
+		int diffCount = MarkDiffIndex(diff3);
+		std::vector<DiffStat> counter(m_diffInfos.size());
+		for (unsigned by = 0; by < diff3.height(); ++by)
+		{
+			const uint64_t *row01 = diff01.row(by);
+			const uint64_t *row21 = diff21.row(by);
+			const uint64_t *row02 = diff02.row(by);
+			for (const auto& run : diff3.row(by))
+			{
+				DiffStat& stat = counter[run.value - 1];
+				const unsigned end = run.x + run.length;
+				for (unsigned w = run.x / 64; w * 64 < end; ++w)
+				{
+					// blocks of the run within this word
+					uint64_t mask = ~uint64_t(0);
+					if (w * 64 < run.x)
+						mask &= ~uint64_t(0) << (run.x - w * 64);
+					if (end - w * 64 < 64)
+						mask &= ~(~uint64_t(0) << (end - w * 64));
+					const uint64_t mask21 = mask & row21[w];
+					const uint64_t mask0221 = mask21 & row02[w];
+					stat.d1 += ImgDiffKernels::PopCount64(mask & ~row21[w]);
+					stat.d2 += ImgDiffKernels::PopCount64(mask21 & ~row02[w]);
+					stat.d3 += ImgDiffKernels::PopCount64(mask0221 & ~row01[w]);
+					stat.detc += ImgDiffKernels::PopCount64(mask0221 & row01[w]);
+				}
+			}
+		}
+		
+		for (size_t i = 0; i < m_diffInfos.size(); ++i)
+		{
+			int op;
+			if (counter[i].d1 != 0 && counter[i].d2 == 0 && counter[i].d3 == 0 && counter[i].detc == 0)
+				op = OP_1STONLY;
+			else if (counter[i].d1 == 0 && counter[i].d2 != 0 && counter[i].d3 == 0 && counter[i].detc == 0)
+				op = OP_2NDONLY;
+			else if (counter[i].d1 == 0 && counter[i].d2 == 0 && counter[i].d3 != 0 && counter[i].detc == 0)
+				op = OP_3RDONLY;
+			else
+				op = OP_DIFF;
+			m_diffInfos[i].op = op;
+		}
+		return diffCount;
+	}
+
+	void Make3WayDiff(const DiffMask& diff01, const DiffMask& diff21, DiffBlocks& diff3)
+	{
+		const ImgDiffKernels::OrMasksFunc orMasks = ImgDiffKernels::GetKernels().orMasks;
+		std::vector<uint64_t> row(diff01.wordsPerRow());
+		for (unsigned by = 0; by < diff3.height(); ++by)
+		{
+			orMasks(diff01.row(by), diff21.row(by), row.data(), row.size());
+			diff3.setRowFromMask(by, row.data(), -1);
+		}
+	}
+
+	inline Image::Color GetDiffColorFromPosition(int pane, int x, int y, Image::Color diffColor, Image::Color diffDeletedColor) const
+	{
+		x -= m_offset[pane].x;
+		y -= m_offset[pane].y;
+
+		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_NONE || 
+			m_lineDiffInfos.size() == 0 ||
+			x < 0 || x >= static_cast<int>(m_imgPreprocessed[pane].width()) ||
+			y < 0 || y >= static_cast<int>(m_imgPreprocessed[pane].height()))
+			return diffColor;
+
+		if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_VERTICAL)
+		{
+			for (auto& lineDiff: m_lineDiffInfos)
+			{
+				if (lineDiff.dbegin <= y && y <= lineDiff.dendmax)
+					return diffDeletedColor;
+			}
+		}
+		else
+		{
+			for (auto& lineDiff : m_lineDiffInfos)
+			{
+				if (lineDiff.dbegin <= x && x <= lineDiff.dendmax)
+					return diffDeletedColor;
+			}
+		}
+		return diffColor;
+	}
+
+	// Marks the diff blocks within the pixel rectangle rc of the composited image of pane
+	void MarkDiff(int pane, const DiffBlocks& diff, const Rect<unsigned>& rc, Image& dst) const
+	{
+		const unsigned bxmin = rc.left / m_diffBlockSize;
+		const unsigned bxmax = (rc.right + m_diffBlockSize - 1) / m_diffBlockSize;
+		const unsigned bymin = rc.top / m_diffBlockSize;
+		const unsigned bymax = (std::min)((rc.bottom + m_diffBlockSize - 1) / m_diffBlockSize, static_cast<unsigned>(diff.height()));
+		const ImgDiffKernels::BlendColorFunc blendColor = ImgDiffKernels::GetKernels().blendColor;
+		const unsigned diffColorAlpha = ImgDiffKernels::FixedPointAlpha(m_diffColorAlpha);
+		const unsigned char transparentAlpha = static_cast<unsigned char>(0xff * m_diffColorAlpha);
+
+		for (unsigned by = bymin; by < bymax; ++by)
+		{
+			const unsigned ymin = (std::max)(by * m_diffBlockSize, rc.top);
+			const unsigned ymax = (std::min)((by + 1) * m_diffBlockSize, rc.bottom);
+			for (const auto& run : diff.row(by))
+			{
+				int diffIndex = run.value;
+				if (diffIndex == 0 ||
+					(pane == 0 && m_diffInfos[diffIndex - 1].op == OP_3RDONLY) ||
+					(pane == 2 && m_diffInfos[diffIndex - 1].op == OP_1STONLY))
+					continue;
+				const unsigned bxbegin = (std::max)(run.x, bxmin);
+				const unsigned bxend = (std::min)(run.x + run.length, bxmax);
+				if (bxbegin >= bxend)
+					continue;
+				// a run covers whole blocks of one diff, so it is blended a scanline span at a time
+				const unsigned xmin = (std::max)(bxbegin * m_diffBlockSize, rc.left);
+				const unsigned xmax = (std::min)(bxend * m_diffBlockSize, rc.right);
+				Image::Color color = (diffIndex - 1 == m_currentDiffIndex) ? m_selDiffColor : m_diffColor;
+				Image::Color colorDeleted = (diffIndex - 1 == m_currentDiffIndex) ? m_selDiffDeletedColor : m_diffDeletedColor;
+				for (unsigned y = ymin; y < ymax; ++y)
+				{
+					unsigned char *scanline = dst.scanLine(y);
+					if (!blendColor(scanline + xmin * 4, xmax - xmin,
+						Image::valueB(color), Image::valueG(color), Image::valueR(color), diffColorAlpha))
+						continue;
+					for (unsigned x = xmin; x < xmax; ++x)
+					{
+						if (scanline[x * 4 + 3] != 0)
+							continue;
+						Image::Color dcolor = GetDiffColorFromPosition(pane, x, y, color, colorDeleted);
+						scanline[x * 4 + 0] = Image::valueB(dcolor);
+						scanline[x * 4 + 1] = Image::valueG(dcolor);
+						scanline[x * 4 + 2] = Image::valueR(dcolor);
+						scanline[x * 4 + 3] = transparentAlpha;
+					}
+				}
+			}
+		}
+	}
+
+	// Copies the rectangle rc of the preprocessed image of pane to dst, clearing what it does not cover
+	void CopyPreprocessedImageToDiffImage(int pane, const Rect<unsigned>& rc, Image& dst) const
+	{
+		unsigned w = m_imgPreprocessed[pane].width();
+		unsigned h = m_imgPreprocessed[pane].height();
+		unsigned offset_x = m_offset[pane].x;
+		unsigned offset_y = m_offset[pane].y;
+		const unsigned xmin = (std::min)((std::max)(rc.left, offset_x), rc.right);
+		const unsigned xmax = (std::max)((std::min)(rc.right, offset_x + w), xmin);
+		for (unsigned y = rc.top; y < rc.bottom; ++y)
+		{
+			unsigned char *scanline_dst = dst.scanLine(y);
+			if (y < offset_y || y >= offset_y + h)
+			{
+				memset(scanline_dst + rc.left * 4, 0, (rc.right - rc.left) * 4);
+				continue;
+			}
+			const unsigned char *scanline_src = m_imgPreprocessed[pane].scanLine(y - offset_y);
+			memset(scanline_dst + rc.left * 4, 0, (xmin - rc.left) * 4);
+			memcpy(scanline_dst + xmin * 4, scanline_src + (xmin - offset_x) * 4, (xmax - xmin) * 4);
+			memset(scanline_dst + xmax * 4, 0, (rc.right - xmax) * 4);
+		}
+	}
+
+	void XorImages2(int src, const Rect<unsigned>& rc, Image& dst) const
+	{
+		unsigned w = m_imgPreprocessed[src].width();
+		unsigned h = m_imgPreprocessed[src].height();
+		unsigned offset_x = m_offset[src].x;
+		unsigned offset_y = m_offset[src].y;
+		const unsigned xmin = (std::max)(rc.left, offset_x);
+		const unsigned xmax = (std::min)(rc.right, offset_x + w);
+		const unsigned ymin = (std::max)(rc.top, offset_y);
+		const unsigned ymax = (std::min)(rc.bottom, offset_y + h);
+		if (xmin >= xmax)
+			return;
+		const ImgDiffKernels::XorColorFunc xorColor = ImgDiffKernels::GetKernels().xorColor;
+		for (unsigned y = ymin; y < ymax; ++y)
+		{
+			const unsigned char *scanline_src = m_imgPreprocessed[src].scanLine(y - offset_y);
+			unsigned char *scanline_dst = dst.scanLine(y);
+			xorColor(scanline_dst + xmin * 4, scanline_src + (xmin - offset_x) * 4, xmax - xmin);
+		}
+	}
+
+	void AlphaBlendImages2(int src, const Rect<unsigned>& rc, Image& dst) const
+	{
+		unsigned w = m_imgPreprocessed[src].width();
+		unsigned h = m_imgPreprocessed[src].height();
+		unsigned offset_x = m_offset[src].x;
+		unsigned offset_y = m_offset[src].y;
+		const unsigned xmin = (std::max)(rc.left, offset_x);
+		const unsigned xmax = (std::min)(rc.right, offset_x + w);
+		const unsigned ymin = (std::max)(rc.top, offset_y);
+		const unsigned ymax = (std::min)(rc.bottom, offset_y + h);
+		if (xmin >= xmax)
+			return;
+		const ImgDiffKernels::BlendFunc blend = ImgDiffKernels::GetKernels().blend;
+		const unsigned overlayAlpha = ImgDiffKernels::FixedPointAlpha(m_composeOverlayAlpha);
+		for (unsigned y = ymin; y < ymax; ++y)
+		{
+			const unsigned char *scanline_src = m_imgPreprocessed[src].scanLine(y - offset_y);
+			unsigned char *scanline_dst = dst.scanLine(y);
+			blend(scanline_dst + xmin * 4, scanline_src + (xmin - offset_x) * 4, xmax - xmin, overlayAlpha);
+		}
+	}
+
+	// Copies the lines of src to dst with the ghost lines of lineDiffInfos inserted, which are
+	// rows, or columns if columns is true. Ghost lines are left transparent.
+	void CopyImageWithGhostLine(const std::vector<LineDiffInfo>& lineDiffInfos, int npanes, Image src[], Image dst[], bool columns = false)
+	{
+		unsigned nlines;
+		const unsigned nsrclines0 = columns ? src[0].width() : src[0].height();
+		if (lineDiffInfos.size() == 0)
+		{
+			nlines = nsrclines0;
+		}
+		else
+		{
+			const LineDiffInfo& lastLineDiff = lineDiffInfos.back();
+			nlines = (lastLineDiff.dendmax + 1) + nsrclines0 - (lastLineDiff.end[0] + 1);
+		}
+
+		for (int pane = 0; pane < npanes; ++pane)
+		{
+			if (columns)
+				dst[pane].setSize(nlines, src[pane].height());
+			else
+				dst[pane].setSize(src[pane].width(), nlines);
+		}
+
+		// copies count lines of pane from line ysrc of src to line ydst of dst
+		auto copyLines = [&](int pane, int ysrc, int ydst, int count)
+		{
+			if (count <= 0)
+				return;
+			if (columns)
+			{
+				for (unsigned y = 0; y < src[pane].height(); ++y)
+					memcpy(dst[pane].scanLine(y) + ydst * 4, src[pane].scanLine(y) + ysrc * 4, count * 4);
+			}
+			else
+			{
+				for (int i = 0; i < count; ++i)
+					memcpy(dst[pane].scanLine(ydst + i), src[pane].scanLine(ysrc + i), src[pane].width() * 4);
+			}
+		};
+
+		int ydst = 0;
+		for (size_t i = 0; i < lineDiffInfos.size(); ++i)
+		{
+			const LineDiffInfo& lineDiffInfo = lineDiffInfos[i];
+
+			for (int pane = 0; pane < npanes; ++pane)
+			{
+				const int ysrc = (i > 0) ? (lineDiffInfos[i - 1].end[pane] + 1) : 0;
+				copyLines(pane, ysrc, ydst, lineDiffInfo.begin[pane] - ysrc);
+			}
+
+			ydst = lineDiffInfo.dbegin;
+			for (int pane = 0; pane < npanes; ++pane)
+				copyLines(pane, lineDiffInfo.begin[pane], ydst, lineDiffInfo.end[pane] + 1 - lineDiffInfo.begin[pane]);
+			ydst = lineDiffInfo.dendmax + 1;
+		}
+
+		for (int pane = 0; pane < npanes; ++pane)
+		{
+			const int ysrc = (lineDiffInfos.size() > 0) ? (lineDiffInfos[lineDiffInfos.size() - 1].end[pane] + 1) : 0;
+			const int nsrclines = static_cast<int>(columns ? src[pane].width() : src[pane].height());
+			copyLines(pane, ysrc, ydst, nsrclines - ysrc);
+		}
+	}
+
+	// The hashes of the lines of a pane for MakeLineDiff, with what they were computed from.
+	// They are kept across compares until the pixels of the pane or the hashing change.
+	struct LineHashes
+	{
+		bool valid;
+		unsigned modCount;
+		INSERTION_DELETION_DETECTION_MODE mode;
+		unsigned quantum;
+		uint32_t channelMask;
+		float angle;
+		bool horizontalFlip;
+		bool verticalFlip;
+		std::vector<unsigned long> hashes;
+	};
+
+	// Tells the line hashes of pane that its pixels have changed
+	void ImageModified(int pane)
+	{
+		++m_imageModCount[pane];
+	}
+
+	// Hashes the lines of the panes that MakeLineDiff will diff, unless their hashes are still
+	// up to date. It runs before the line diffs, which then only read the hashes.
+	void UpdateLineHashes()
+	{
+		const ImgDiffKernels::ColorDistanceWeights weights = GetEffectiveColorDistanceWeights();
+		const unsigned quantum = hashQuantum(m_colorDistanceThreshold);
+		const uint32_t channelMask = hashChannelMask(weights);
+		for (int pane = 0; pane < m_nImages; ++pane)
+		{
+			LineHashes& lh = m_lineHashes[pane];
+			if (lh.valid && lh.modCount == m_imageModCount[pane] && lh.mode == m_insertionDeletionDetectionMode &&
+				lh.quantum == quantum && lh.channelMask == channelMask && lh.angle == m_angle[pane] &&
+				lh.horizontalFlip == m_horizontalFlip[pane] && lh.verticalFlip == m_verticalFlip[pane])
+				continue;
+			if (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_HORIZONTAL)
+				ColumnDataForDiff::HashLines(m_imgOrig32[pane], m_colorDistanceThreshold, weights, m_workerPool, lh.hashes);
+			else
+				DataForDiff::HashLines(m_imgOrig32[pane], m_colorDistanceThreshold, weights, m_workerPool, lh.hashes);
+			lh.valid = true;
+			lh.modCount = m_imageModCount[pane];
+			lh.mode = m_insertionDeletionDetectionMode;
+			lh.quantum = quantum;
+			lh.channelMask = channelMask;
+			lh.angle = m_angle[pane];
+			lh.horizontalFlip = m_horizontalFlip[pane];
+			lh.verticalFlip = m_verticalFlip[pane];
+		}
+	}
+
+	// Diffs the rows of two panes, or their columns with ColumnDataForDiff, with the line
+	// hashes from UpdateLineHashes. truncated tells whether the diff limits cut the diff short.
+	template<class Data = DataForDiff>
+	std::vector<LineDiffInfo> MakeLineDiff(int pane1, int pane2, bool& truncated)
+	{
+		const ImgDiffKernels::ColorDistanceWeights weights = GetEffectiveColorDistanceWeights();
+		Data data1(m_imgOrig32[pane1], m_colorDistanceThreshold, weights);
+		Data data2(m_imgOrig32[pane2], m_colorDistanceThreshold, weights);
+		Diff<Data> diff(data1, data2, m_lineHashes[pane1].hashes.data(), m_lineHashes[pane2].hashes.data());
+		std::vector<char> edscript;
+		std::vector<LineDiffInfo> lineDiffInfosTmp;
+		std::vector<LineDiffInfo> lineDiffInfos;
+
+		diff.setLimits(m_diffCostLimit, m_diffTimeLimit);
+		diff.diff(static_cast<typename Diff<Data>::Algorithm>(m_diffAlgorithm), edscript);
+		truncated = diff.truncated();
+
+		int i = 0, j = 0;
+		for (auto ed : edscript)
+		{
+			switch (ed)
+			{
+			case '-':
+				lineDiffInfosTmp.emplace_back(i, i, j, j - 1);
+				++i;
+				break;
+			case '+':
+				lineDiffInfosTmp.emplace_back(i, i - 1, j, j);
+				++j;
+				break;
+			case '!':
+				lineDiffInfosTmp.emplace_back(i, i, j, j);
+				++i;
+				++j;
+				break;
+			default:
+				++i;
+				++j;
+				break;
+			}
+		}
+
+		lineDiffInfos.clear();
+		for (size_t i = 0; i < lineDiffInfosTmp.size(); ++i)
+		{
+			bool skipIt = false;
+			// combine it with next ?
+			if (i + 1 < (int)lineDiffInfosTmp.size())
+			{
+				if (lineDiffInfosTmp[i].end[0] + 1 == lineDiffInfosTmp[i + 1].begin[0]
+					&& lineDiffInfosTmp[i].end[1] + 1 == lineDiffInfosTmp[i + 1].begin[1])
+				{
+					// diff[i] and diff[i+1] are contiguous
+					// so combine them into diff[i+1] and ignore diff[i]
+					lineDiffInfosTmp[i + 1].begin[0] = lineDiffInfosTmp[i].begin[0];
+					lineDiffInfosTmp[i + 1].begin[1] = lineDiffInfosTmp[i].begin[1];
+					skipIt = true;
+				}
+			}
+			if (!skipIt)
+			{
+				// Should never have a pair where both are missing
+				assert(lineDiffInfosTmp[i].begin[0] >= 0 || lineDiffInfosTmp[i].begin[1] >= 0);
+
+				// Store the diff[i] in the caller list (m_pDiffs)
+				lineDiffInfos.push_back(lineDiffInfosTmp[i]);
+			}
+		}
+
+		return lineDiffInfos;
+	}
+
+	unsigned PrimeLineDiffInfos(std::vector<LineDiffInfo>& lineDiffInfos, int npanes, unsigned height0)
+	{
+		unsigned dlines = 0;
+		for (size_t i = 0; i < lineDiffInfos.size(); ++i)
+		{
+			dlines += lineDiffInfos[i].begin[0] - ((i > 0) ? (lineDiffInfos[i - 1].end[0] + 1) : 0);
+
+			LineDiffInfo& lineDiffInfo = lineDiffInfos[i];
+			lineDiffInfo.dbegin = dlines;
+			lineDiffInfo.dendmax = 0;
+			for (int pane = 0; pane < npanes; ++pane)
+			{
+				lineDiffInfo.dend[pane] = lineDiffInfo.dbegin + lineDiffInfo.end[pane] - lineDiffInfo.begin[pane];
+				if (lineDiffInfo.dendmax < lineDiffInfo.dbegin + lineDiffInfo.end[pane] - lineDiffInfo.begin[pane])
+					lineDiffInfo.dendmax = lineDiffInfo.dbegin + lineDiffInfo.end[pane] - lineDiffInfo.begin[pane];
+			}
+			dlines = lineDiffInfo.dendmax + 1;
+		}
+		dlines += height0 - (lineDiffInfos.size() > 0 ? lineDiffInfos[lineDiffInfos.size() - 1].end[0] + 1 : 0);
+		return dlines;
+	}
+
+	class TemporaryTransformation
+	{
+	public:
+		TemporaryTransformation(CImgDiffBuffer& buffer)
+			: m_buffer(buffer)
+		{
+			m_buffer.TransformImages(false);
+		}
+
+		~TemporaryTransformation()
+		{
+			m_buffer.TransformImages(true);
+		}
+	private:
+		CImgDiffBuffer& m_buffer;
+	};
+
+	void TransformImages(bool reverse)
+	{
+		m_temporarilyTransformed = !reverse;
+		for (int pane = 0; pane < m_nImages; ++pane)
+		{
+			if (!reverse)
+			{
+				if (m_horizontalFlip[pane])
+					m_imgOrig32[pane].flipHorizontal();
+				if (m_verticalFlip[pane])
+					m_imgOrig32[pane].flipVertical();
+				if (m_angle[pane])
+					m_imgOrig32[pane].rotate(m_angle[pane]);
+			}
+			else
+			{
+				if (m_angle[pane])
+					m_imgOrig32[pane].rotate(-m_angle[pane]);
+				if (m_horizontalFlip[pane])
+					m_imgOrig32[pane].flipHorizontal();
+				if (m_verticalFlip[pane])
+					m_imgOrig32[pane].flipVertical();
+			}
+		}
+	}
+
+	bool PreprocessImages()
+	{
+		const int threshold2 = ImgDiffKernels::ColorDistanceThreshold2(m_colorDistanceThreshold);
+		const ImgDiffKernels::ColorDistanceWeights weights = GetEffectiveColorDistanceWeights();
+		auto compfunc02 = [&](const LineDiffInfo & wd3) {
+			unsigned wlen0 = wd3.end[0] + 1 - wd3.begin[0];
+			unsigned wlen2 = wd3.end[2] + 1 - wd3.begin[2];
+			if (wlen0 != wlen2)
+				return false;
+			const bool columns = (m_insertionDeletionDetectionMode == INSERTION_DELETION_DETECTION_HORIZONTAL);
+			for (unsigned i = 0; i < wlen0; ++i)
+			{
+				const bool equal = columns ?
+					acolumnEquals(m_imgOrig32[0], m_imgOrig32[2], wd3.begin[0] + i, wd3.begin[2] + i, threshold2, weights) :
+					alineEquals(m_imgOrig32[0], m_imgOrig32[2], wd3.begin[0] + i, wd3.begin[2] + i, threshold2, weights);
+				if (!equal)
+					return false;
+			}
+			return true;
+		};
+		
+		TemporaryTransformation tmp(*this);
+
+		m_lineDiffTruncated = false;
+		// identical images need neither a line diff nor a block compare
+		if (AreImagesIdentical(m_imgOrig32))
+		{
+			m_lineDiffInfos.clear();
+			for (int i = 0; i < m_nImages; ++i)
+				m_imgPreprocessed[i] = m_imgOrig32[i];
+			return true;
+		}
+
+		std::vector<LineDiffInfo> lineDiffInfos10, lineDiffInfos12;
+		bool truncated[2] = {};
+		switch (m_insertionDeletionDetectionMode)
+		{
+		case INSERTION_DELETION_DETECTION_VERTICAL:
+		{
+			UpdateLineHashes();
+			if (m_nImages == 2)
+				 m_lineDiffInfos = MakeLineDiff(0, 1, truncated[0]);
+			else
+			{
+				// DataForDiff only reads the images and their hashes, so both diffs against pane 1 can run at once
+				m_workerPool.ParallelFor(2, [&](unsigned i)
+					{ (i == 0 ? lineDiffInfos10 : lineDiffInfos12) = MakeLineDiff(1, i * 2, truncated[i]); });
+				m_lineDiffInfos = ::Make3WayLineDiff(lineDiffInfos10, lineDiffInfos12, compfunc02);
+			}
+			PrimeLineDiffInfos(m_lineDiffInfos, m_nImages, m_imgOrig32[0].height());
+			CopyImageWithGhostLine(m_lineDiffInfos, m_nImages, m_imgOrig32, m_imgPreprocessed);
+			break;
+		}
+		case INSERTION_DELETION_DETECTION_HORIZONTAL:
+		{
+			UpdateLineHashes();
+			if (m_nImages == 2)
+				m_lineDiffInfos = MakeLineDiff<ColumnDataForDiff>(0, 1, truncated[0]);
+			else
+			{
+				// ColumnDataForDiff only reads the images and their hashes, so both diffs against pane 1 can run at once
+				m_workerPool.ParallelFor(2, [&](unsigned i)
+					{ (i == 0 ? lineDiffInfos10 : lineDiffInfos12) = MakeLineDiff<ColumnDataForDiff>(1, i * 2, truncated[i]); });
+				m_lineDiffInfos = ::Make3WayLineDiff(lineDiffInfos10, lineDiffInfos12, compfunc02);
+			}
+			PrimeLineDiffInfos(m_lineDiffInfos, m_nImages, m_imgOrig32[0].width());
+			CopyImageWithGhostLine(m_lineDiffInfos, m_nImages, m_imgOrig32, m_imgPreprocessed, true);
+			break;
+		}
+		default:
+			m_lineDiffInfos.clear();
+			for (int i = 0; i < m_nImages; ++i)
+				m_imgPreprocessed[i] = m_imgOrig32[i];
+			break;
+		}
+		m_lineDiffTruncated = truncated[0] || truncated[1];
+		return false;
+	}
+
+	int m_nImages;
+	MultiPageImages m_imgOrigMultiPage[3];
+	Point<unsigned> m_offset[3];
+	Image m_imgOrig[3];
+	Image m_imgOrig32[3];
+	Image m_imgPreprocessed[3];
+	mutable Image m_imgDiff[3]; // composited on demand, tile by tile, see ComposeRect
+	mutable Image m_imgDiffBack[3]; // the other blink frame, see UpdateAnimationFrame
+	Image m_imgDiffMap;
+	bool m_diffMapValid; // whether m_imgDiffMap shows the current diffs and selection
+	std::vector<unsigned> m_diffMapCounts; // summed-area table of the blocks that differ, see BuildDiffMapCounts
+	ImgConverter m_imgConverter[3];
+	std::wstring m_filename[3];
+	bool m_showDifferences;
+	bool m_blinkDifferences;
+	float m_vectorImageZoomRatio;
+	INSERTION_DELETION_DETECTION_MODE m_insertionDeletionDetectionMode;
+	OVERLAY_MODE m_overlayMode;
+	double m_overlayAlpha;
+	WIPE_MODE m_wipeMode;
+	int m_wipePosition;
+	unsigned m_diffBlockSize;
+	Image::Color m_selDiffColor;
+	Image::Color m_selDiffDeletedColor;
+	Image::Color m_diffColor;
+	Image::Color m_diffDeletedColor;
+	double m_diffColorAlpha;
+	double m_colorDistanceThreshold;
+	ImgDiffKernels::ColorDistanceWeights m_colorDistanceWeights;
+	bool m_ignoreAlphaDifferences;
+	float m_angle[3];
+	bool m_horizontalFlip[3];
+	bool m_verticalFlip[3];
+	int m_currentPage[3];
+	int m_currentDiffIndex;
+	int m_diffCount;
+	DiffBlocks m_diff;
+	DiffMask m_diff01, m_diff21, m_diff02;
+	std::vector<DiffInfo> m_diffInfos;
+	std::vector<LineDiffInfo> m_lineDiffInfos;
+	unsigned m_imageModCount[3]{}; // bumped by ImageModified
+	LineHashes m_lineHashes[3]{};
+	bool m_temporarilyTransformed;
+	DIFF_ALGORITHM m_diffAlgorithm;
+	int m_blinkInterval;
+	int m_overlayAnimationInterval;
+	int m_overlayAnimationSteps;       // steps of the animated overlay alpha, 0 for a continuous alpha
+	int m_overlayAnimationCacheSize;   // megabytes of frames of the animated overlay kept composited
+	int m_lastErrorCode;
+	int m_diffCostLimit; // edit cost at which a split of the line diff gives up, 0 for no limit
+	int m_diffTimeLimit; // milliseconds after which a line diff gives up, 0 for no limit
+	bool m_lineDiffTruncated; // whether the limits cut the last line diff short
+	unsigned m_compareThreadCount;
+	mutable WorkerPool m_workerPool; // the threads besides the calling one for m_compareThreadCount
+	bool m_composeShowDiff;       // whether the diff highlight is shown in the current frame
+	double m_composeOverlayAlpha; // overlay alpha of the current frame
+	unsigned m_tileCountX, m_tileCountY;
+	mutable std::vector<unsigned char> m_tileComposed[3];
+	mutable std::vector<unsigned char> m_tileComposedBack[3];
+	std::list<OverlayFrame> m_overlayFrames; // a list, since Image copies its bitmap when moved
+	std::vector<Rect<int> > m_dirtyRects[3]; // changed since the last TakeDirtyRects
+	MipmapLevel m_mipmaps[3][MAX_MIPMAP_LEVEL];     // levels 1 and up of the image GetDisplayImage returns
+	MipmapLevel m_mipmapsBack[3][MAX_MIPMAP_LEVEL]; // levels 1 and up of the back blink frame
+	bool m_imgDiffIsTransparent[3]{};
+	bool m_imgPreprocessedIsTransparent[3]{};
+	bool m_composePassThrough[3]{}; // whether the pane is drawn straight from m_imgPreprocessed
+};
@@ -0,0 +1,1179 @@
+/////////////////////////////////////////////////////////////////////////////
+//    License (GPLv2+):
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define IMGDIFF_KERNELS_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define IMGDIFF_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define IMGDIFF_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMGDIFF_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define IMGDIFF_TARGET_SSE2
+#define IMGDIFF_TARGET_AVX2
+#endif
+
+/*
+ * Pixel kernels used by CImgDiffBuffer::CompareImages2 and by the compositing
+ * of the diff images.
+ *
+ * Every kernel compares a span of 32-bit BGRA pixels of two scanlines and
+ * sets the entries of the current diff block row that contain at least one
+ * differing pixel to -1. The scalar kernels are the reference implementation;
+ * the SIMD kernels must produce exactly the same block marks.
+ *
+ * Threshold kernels work on integers only: a pixel differs when the weighted
+ * squared color distance b*db*db + g*dg*dg + r*dr*dr + a*da*da is greater
+ * than threshold2.
+ *
+ * The blend kernels used to composite the diff images mix 8-bit channels with
+ * an 8.8 fixed-point alpha: (d * (256 - alpha) + s * alpha) >> 8, which never
+ * leaves 16 bits. Again the SIMD kernels match the scalar ones exactly.
+ *
+ * The levels of the mipmap pyramid of the diff images are reduced with a 2x2
+ * box filter rounded to nearest, (a + b + c + d + 2) >> 2 for each channel.
+ *
+ * The lines of the insertion detection are hashed a stripe of 8 pixels at a
+ * time, the last one padded with zeros. The channels are masked and, for a
+ * color distance threshold, divided by a quantum as (c * reciprocal) >> 16,
+ * which is exact for 8-bit values. Word j of the 4 64-bit words of stripe s
+ * is added to lane j as acc += d + lo32(d ^ key) * hi32(d ^ key), where
+ * key = LINE_HASH_KEY[j] + s * LINE_HASH_KEY_STEP[j], and the lanes are folded
+ * with the width at the end. All kernels compute the same hash.
+ */
+namespace ImgDiffKernels
+{
+	enum ISA { ISA_SCALAR = 0, ISA_SSE2, ISA_AVX2, ISA_NEON };
+
+	enum { MAX_COLOR_DISTANCE_WEIGHT = 128 };
+
+	// Per-channel weights of the squared color distance, 0 to MAX_COLOR_DISTANCE_WEIGHT.
+	// The limit keeps weight * difference within 16 bits for the SIMD kernels.
+	struct ColorDistanceWeights
+	{
+		short b, g, r, a;
+
+		static ColorDistanceWeights Unit()
+		{
+			return { 1, 1, 1, 1 };
+		}
+
+		bool IsUnit() const
+		{
+			return b == 1 && g == 1 && r == 1 && a == 1;
+		}
+	};
+
+	// scanline1 and scanline2 point to the first pixel of the span, x is the position
+	// of that pixel on the diff canvas and blocks points to the first block of the row.
+	typedef void (*MarkDiffBlocksExactFunc)(const unsigned char *scanline1, const unsigned char *scanline2,
+		unsigned width, unsigned x, unsigned blockSize, int *blocks);
+	typedef void (*MarkDiffBlocksThresholdFunc)(const unsigned char *scanline1, const unsigned char *scanline2,
+		unsigned width, unsigned x, unsigned blockSize, int *blocks, int threshold2, const ColorDistanceWeights& weights);
+	// Returns true when no pixel of the span differs, stopping at the first difference.
+	typedef bool (*EqualsThresholdFunc)(const unsigned char *scanline1, const unsigned char *scanline2,
+		unsigned width, int threshold2, const ColorDistanceWeights& weights);
+	// result[i] = mask1[i] | mask2[i] for count 64-bit words of a bit mask
+	typedef void (*OrMasksFunc)(const uint64_t *mask1, const uint64_t *mask2, uint64_t *result, size_t count);
+	// Blends the color into the pixels of the span whose alpha is not zero, keeping their alpha.
+	// Pixels with zero alpha are left unchanged; returns whether there were any.
+	typedef bool (*BlendColorFunc)(unsigned char *pixels, unsigned width,
+		unsigned char b, unsigned char g, unsigned char r, unsigned alpha);
+	// Blends all four channels of the src pixels into the dst pixels
+	typedef void (*BlendFunc)(unsigned char *dst, const unsigned char *src, unsigned width, unsigned alpha);
+	// XORs the color channels of the src pixels into the dst pixels, keeping the alpha of dst
+	typedef void (*XorColorFunc)(unsigned char *dst, const unsigned char *src, unsigned width);
+	// Averages the 2x2 pixels of the rows src0 and src1, 2 * width pixels each, into the width
+	// pixels of dst, rounded to nearest
+	typedef void (*ReduceHalfFunc)(unsigned char *dst, const unsigned char *src0, const unsigned char *src1, unsigned width);
+	// Hashes a line of pixels, leaving out the channels whose byte of channelMask is zero and
+	// dividing the others by quantum first when it is greater than 1
+	typedef uint64_t (*HashLineFunc)(const unsigned char *scanline, unsigned width, uint32_t channelMask, unsigned quantum);
+
+	struct Kernels
+	{
+		ISA isa;
+		MarkDiffBlocksExactFunc markDiffBlocksExact;
+		MarkDiffBlocksThresholdFunc markDiffBlocksThreshold;
+		// same as above, specialized for power-of-two block sizes
+		MarkDiffBlocksExactFunc markDiffBlocksExactPow2;
+		MarkDiffBlocksThresholdFunc markDiffBlocksThresholdPow2;
+		EqualsThresholdFunc equalsThreshold;
+		OrMasksFunc orMasks;
+		BlendColorFunc blendColor;
+		BlendFunc blend;
+		XorColorFunc xorColor;
+		ReduceHalfFunc reduceHalf;
+		HashLineFunc hashLine;
+	};
+
+	// Converts an alpha from 0.0 to 1.0 to the 0 to 256 of the blend kernels
+	inline unsigned FixedPointAlpha(double alpha)
+	{
+		if (alpha <= 0.0)
+			return 0;
+		if (alpha >= 1.0)
+			return 256;
+		return static_cast<unsigned>(alpha * 256 + 0.5);
+	}
+
+	// A pixel differs when its squared color distance is greater than threshold * threshold.
+	// Squared distances are integers, so comparing against the floor of the square is exact.
+	inline int ColorDistanceThreshold2(double threshold)
+	{
+		double threshold2 = std::floor(threshold * threshold);
+		return threshold2 >= INT_MAX ? INT_MAX : static_cast<int>(threshold2);
+	}
+
+	// Whether a compare with these parameters is a plain byte compare.
+	inline bool IsExactCompare(int threshold2, const ColorDistanceWeights& weights)
+	{
+		return threshold2 == 0 && weights.IsUnit();
+	}
+
+	inline unsigned CountTrailingZeros(unsigned mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	inline unsigned CountTrailingZeros64(uint64_t mask)
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return index;
+#elif defined(_MSC_VER)
+		const unsigned low = static_cast<unsigned>(mask);
+		return low ? CountTrailingZeros(low) : 32 + CountTrailingZeros(static_cast<unsigned>(mask >> 32));
+#else
+		return __builtin_ctzll(mask);
+#endif
+	}
+
+	inline unsigned PopCount64(uint64_t mask)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_popcountll(mask);
+#else
+		// the POPCNT instruction is not part of the x64 baseline, so count the bits in parallel
+		mask = mask - ((mask >> 1) & 0x5555555555555555ULL);
+		mask = (mask & 0x3333333333333333ULL) + ((mask >> 2) & 0x3333333333333333ULL);
+		mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return static_cast<unsigned>((mask * 0x0101010101010101ULL) >> 56);
+#endif
+	}
+
+	inline bool IsPowerOfTwo(unsigned value)
+	{
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+
+	// Maps a pixel position to its block index with a division
+	struct BlockIndexDiv
+	{
+		explicit BlockIndexDiv(unsigned blockSize) : blockSize(blockSize) {}
+		unsigned operator()(unsigned x) const { return x / blockSize; }
+		unsigned blockSize;
+	};
+
+	// Maps a pixel position to its block index with a shift, for power-of-two block sizes
+	struct BlockIndexShift
+	{
+		explicit BlockIndexShift(unsigned blockSize) : shift(CountTrailingZeros(blockSize)) {}
+		unsigned operator()(unsigned x) const { return x >> shift; }
+		unsigned shift;
+	};
+
+	const uint64_t LINE_HASH_KEY[4] = {
+		0x9E3779B185EBCA87ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x85EBCA77C2B2AE63ULL };
+	const uint64_t LINE_HASH_KEY_STEP[4] = {
+		0x27D4EB2F165667C5ULL, 0x94D049BB133111EBULL, 0xBF58476D1CE4E5B9ULL, 0xD6E8FEB86659FD93ULL };
+
+	// The lanes of a line hash after some stripes
+	struct LineHashState
+	{
+		uint64_t acc[4];
+		uint64_t key[4];
+	};
+
+	// The multiplier that divides 8-bit values by quantum in the line hash, 0 for no division
+	inline unsigned LineHashReciprocal(unsigned quantum)
+	{
+		return quantum > 1 ? (65536 + quantum - 1) / quantum : 0;
+	}
+
+	template<class BlockIndex>
+	inline void MarkDiffBlocksFromMask(unsigned mask, unsigned x, const BlockIndex& blockIndex, int *blocks)
+	{
+		while (mask)
+		{
+			blocks[blockIndex(x + CountTrailingZeros(mask))] = -1;
+			mask &= mask - 1;
+		}
+	}
+
+	namespace Scalar
+	{
+		inline int ColorDistance2(const unsigned char *p1, const unsigned char *p2, const ColorDistanceWeights& weights)
+		{
+			int bdist = p1[0] - p2[0];
+			int gdist = p1[1] - p2[1];
+			int rdist = p1[2] - p2[2];
+			int adist = p1[3] - p2[3];
+			return weights.r * rdist * rdist + weights.g * gdist * gdist + weights.b * bdist * bdist + weights.a * adist * adist;
+		}
+
+		template<class BlockIndex>
+		inline void MarkDiffBlocksExact(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks)
+		{
+			const BlockIndex blockIndex(blockSize);
+			for (unsigned i = 0; i < width; ++i)
+			{
+				if (memcmp(scanline1 + i * 4, scanline2 + i * 4, 4) != 0)
+					blocks[blockIndex(x + i)] = -1;
+			}
+		}
+
+		template<class BlockIndex>
+		inline void MarkDiffBlocksThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks, int threshold2, const ColorDistanceWeights& weights)
+		{
+			const BlockIndex blockIndex(blockSize);
+			for (unsigned i = 0; i < width; ++i)
+			{
+				if (ColorDistance2(scanline1 + i * 4, scanline2 + i * 4, weights) > threshold2)
+					blocks[blockIndex(x + i)] = -1;
+			}
+		}
+
+		inline bool EqualsThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, int threshold2, const ColorDistanceWeights& weights)
+		{
+			for (unsigned i = 0; i < width; ++i)
+			{
+				if (ColorDistance2(scanline1 + i * 4, scanline2 + i * 4, weights) > threshold2)
+					return false;
+			}
+			return true;
+		}
+
+		inline void OrMasks(const uint64_t *mask1, const uint64_t *mask2, uint64_t *result, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				result[i] = mask1[i] | mask2[i];
+		}
+
+		inline bool BlendColor(unsigned char *pixels, unsigned width,
+			unsigned char b, unsigned char g, unsigned char r, unsigned alpha)
+		{
+			const unsigned ialpha = 256 - alpha;
+			bool transparent = false;
+			for (unsigned i = 0; i < width; ++i)
+			{
+				unsigned char *p = pixels + i * 4;
+				if (p[3] == 0)
+				{
+					transparent = true;
+					continue;
+				}
+				p[0] = static_cast<unsigned char>((p[0] * ialpha + b * alpha) >> 8);
+				p[1] = static_cast<unsigned char>((p[1] * ialpha + g * alpha) >> 8);
+				p[2] = static_cast<unsigned char>((p[2] * ialpha + r * alpha) >> 8);
+			}
+			return transparent;
+		}
+
+		inline void Blend(unsigned char *dst, const unsigned char *src, unsigned width, unsigned alpha)
+		{
+			const unsigned ialpha = 256 - alpha;
+			for (unsigned i = 0; i < width * 4; ++i)
+				dst[i] = static_cast<unsigned char>((dst[i] * ialpha + src[i] * alpha) >> 8);
+		}
+
+		inline void XorColor(unsigned char *dst, const unsigned char *src, unsigned width)
+		{
+			for (unsigned i = 0; i < width; ++i)
+			{
+				dst[i * 4 + 0] ^= src[i * 4 + 0];
+				dst[i * 4 + 1] ^= src[i * 4 + 1];
+				dst[i * 4 + 2] ^= src[i * 4 + 2];
+			}
+		}
+
+		inline void ReduceHalf(unsigned char *dst, const unsigned char *src0, const unsigned char *src1, unsigned width)
+		{
+			for (unsigned i = 0; i < width * 4; ++i)
+			{
+				const unsigned j = (i / 4) * 8 + i % 4;
+				dst[i] = static_cast<unsigned char>((src0[j] + src0[j + 4] + src1[j] + src1[j + 4] + 2) >> 2);
+			}
+		}
+
+		inline void HashStripe(LineHashState& state, const unsigned char *pixels, uint32_t channelMask, unsigned reciprocal)
+		{
+			unsigned char bytes[32];
+			for (unsigned i = 0; i < 32; ++i)
+			{
+				const unsigned c = pixels[i] & (channelMask >> ((i % 4) * 8)) & 0xff;
+				bytes[i] = static_cast<unsigned char>(reciprocal ? (c * reciprocal) >> 16 : c);
+			}
+			for (unsigned j = 0; j < 4; ++j)
+			{
+				uint64_t d;
+				memcpy(&d, bytes + j * 8, 8);
+				const uint64_t k = d ^ state.key[j];
+				state.acc[j] += d + (k & 0xffffffff) * (k >> 32);
+				state.key[j] += LINE_HASH_KEY_STEP[j];
+			}
+		}
+
+		// Hashes the last pixels of a line, fewer than a stripe, and folds the lanes
+		inline uint64_t FinishHashLine(LineHashState& state, const unsigned char *pixels, unsigned width,
+			unsigned lineWidth, uint32_t channelMask, unsigned reciprocal)
+		{
+			if (width > 0)
+			{
+				unsigned char stripe[32] = {};
+				memcpy(stripe, pixels, width * 4);
+				HashStripe(state, stripe, channelMask, reciprocal);
+			}
+			uint64_t h = lineWidth * 0x9E3779B97F4A7C15ULL;
+			for (unsigned j = 0; j < 4; ++j)
+			{
+				h = (h ^ state.acc[j]) * 0xBF58476D1CE4E5B9ULL;
+				h ^= h >> 31;
+			}
+			return h;
+		}
+
+		inline uint64_t HashLine(const unsigned char *scanline, unsigned width, uint32_t channelMask, unsigned quantum)
+		{
+			const unsigned reciprocal = LineHashReciprocal(quantum);
+			LineHashState state;
+			for (unsigned j = 0; j < 4; ++j)
+			{
+				state.acc[j] = 0;
+				state.key[j] = LINE_HASH_KEY[j];
+			}
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+				HashStripe(state, scanline + i * 4, channelMask, reciprocal);
+			return FinishHashLine(state, scanline + i * 4, width - i, width, channelMask, reciprocal);
+		}
+	}
+
+#ifdef IMGDIFF_KERNELS_X86
+	namespace SSE2
+	{
+		IMGDIFF_TARGET_SSE2
+		inline __m128i Weights(const ColorDistanceWeights& weights)
+		{
+			return _mm_setr_epi16(weights.b, weights.g, weights.r, weights.a, weights.b, weights.g, weights.r, weights.a);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline __m128i ColorDistance2x4(__m128i p1, __m128i p2, __m128i weightsv)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			__m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(p1, zero), _mm_unpacklo_epi8(p2, zero));
+			__m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(p1, zero), _mm_unpackhi_epi8(p2, zero));
+			// (b*db*db + g*dg*dg, r*dr*dr + a*da*da) pairs for two pixels per register
+			__m128i slo = _mm_madd_epi16(_mm_mullo_epi16(dlo, weightsv), dlo);
+			__m128i shi = _mm_madd_epi16(_mm_mullo_epi16(dhi, weightsv), dhi);
+			slo = _mm_add_epi32(slo, _mm_srli_epi64(slo, 32));
+			shi = _mm_add_epi32(shi, _mm_srli_epi64(shi, 32));
+			slo = _mm_shuffle_epi32(slo, _MM_SHUFFLE(3, 3, 2, 0));
+			shi = _mm_shuffle_epi32(shi, _MM_SHUFFLE(3, 3, 2, 0));
+			return _mm_unpacklo_epi64(slo, shi);
+		}
+
+		template<class BlockIndex>
+		IMGDIFF_TARGET_SSE2
+		inline void MarkDiffBlocksExact(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks)
+		{
+			const BlockIndex blockIndex(blockSize);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				__m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(scanline1 + i * 4));
+				__m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(scanline2 + i * 4));
+				unsigned mask = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(p1, p2))) & 0xf;
+				MarkDiffBlocksFromMask(mask, x + i, blockIndex, blocks);
+			}
+			Scalar::MarkDiffBlocksExact<BlockIndex>(scanline1 + i * 4, scanline2 + i * 4, width - i, x + i, blockSize, blocks);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline unsigned DiffMask4(const unsigned char *p1, const unsigned char *p2, __m128i thresholdv, __m128i weightsv)
+		{
+			__m128i dist2 = ColorDistance2x4(
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(p1)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(p2)), weightsv);
+			return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(dist2, thresholdv)));
+		}
+
+		template<class BlockIndex>
+		IMGDIFF_TARGET_SSE2
+		inline void MarkDiffBlocksThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks, int threshold2, const ColorDistanceWeights& weights)
+		{
+			const BlockIndex blockIndex(blockSize);
+			const __m128i thresholdv = _mm_set1_epi32(threshold2);
+			const __m128i weightsv = Weights(weights);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				unsigned mask = DiffMask4(scanline1 + i * 4, scanline2 + i * 4, thresholdv, weightsv);
+				MarkDiffBlocksFromMask(mask, x + i, blockIndex, blocks);
+			}
+			Scalar::MarkDiffBlocksThreshold<BlockIndex>(scanline1 + i * 4, scanline2 + i * 4, width - i, x + i, blockSize, blocks, threshold2, weights);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline bool EqualsThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, int threshold2, const ColorDistanceWeights& weights)
+		{
+			const __m128i thresholdv = _mm_set1_epi32(threshold2);
+			const __m128i weightsv = Weights(weights);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				if (DiffMask4(scanline1 + i * 4, scanline2 + i * 4, thresholdv, weightsv))
+					return false;
+			}
+			return Scalar::EqualsThreshold(scanline1 + i * 4, scanline2 + i * 4, width - i, threshold2, weights);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline void OrMasks(const uint64_t *mask1, const uint64_t *mask2, uint64_t *result, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2)
+			{
+				__m128i m1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask1 + i));
+				__m128i m2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask2 + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(result + i), _mm_or_si128(m1, m2));
+			}
+			Scalar::OrMasks(mask1 + i, mask2 + i, result + i, count - i);
+		}
+
+		// (d * weight + addend) >> 8 for 16-bit lanes that cannot overflow
+		IMGDIFF_TARGET_SSE2
+		inline __m128i BlendFixedPoint(__m128i d, __m128i weightv, __m128i addendv)
+		{
+			return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, weightv), addendv), 8);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline bool BlendColor(unsigned char *pixels, unsigned width,
+			unsigned char b, unsigned char g, unsigned char r, unsigned alpha)
+		{
+			const short ialpha = static_cast<short>(256 - alpha);
+			const short ba = static_cast<short>(b * alpha), ga = static_cast<short>(g * alpha), ra = static_cast<short>(r * alpha);
+			// the alpha channel is multiplied by 256 and shifted back, which keeps it
+			const __m128i weightv = _mm_setr_epi16(ialpha, ialpha, ialpha, 256, ialpha, ialpha, ialpha, 256);
+			const __m128i addendv = _mm_setr_epi16(ba, ga, ra, 0, ba, ga, ra, 0);
+			const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xff000000));
+			const __m128i zero = _mm_setzero_si128();
+			int transparent = 0;
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4));
+				__m128i lo = BlendFixedPoint(_mm_unpacklo_epi8(p, zero), weightv, addendv);
+				__m128i hi = BlendFixedPoint(_mm_unpackhi_epi8(p, zero), weightv, addendv);
+				__m128i isTransparent = _mm_cmpeq_epi32(_mm_and_si128(p, alphaMask), zero);
+				__m128i blended = _mm_or_si128(_mm_and_si128(isTransparent, p), _mm_andnot_si128(isTransparent, _mm_packus_epi16(lo, hi)));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i * 4), blended);
+				transparent |= _mm_movemask_epi8(isTransparent);
+			}
+			return Scalar::BlendColor(pixels + i * 4, width - i, b, g, r, alpha) || transparent != 0;
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline void Blend(unsigned char *dst, const unsigned char *src, unsigned width, unsigned alpha)
+		{
+			const __m128i ialphav = _mm_set1_epi16(static_cast<short>(256 - alpha));
+			const __m128i alphav = _mm_set1_epi16(static_cast<short>(alpha));
+			const __m128i zero = _mm_setzero_si128();
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i * 4));
+				__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+				__m128i lo = BlendFixedPoint(_mm_unpacklo_epi8(d, zero), ialphav, _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), alphav));
+				__m128i hi = BlendFixedPoint(_mm_unpackhi_epi8(d, zero), ialphav, _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), alphav));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(lo, hi));
+			}
+			Scalar::Blend(dst + i * 4, src + i * 4, width - i, alpha);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline void XorColor(unsigned char *dst, const unsigned char *src, unsigned width)
+		{
+			const __m128i colorMask = _mm_set1_epi32(0x00ffffff);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i * 4));
+				__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_xor_si128(d, _mm_and_si128(s, colorMask)));
+			}
+			Scalar::XorColor(dst + i * 4, src + i * 4, width - i);
+		}
+
+		// Sums of the vertical pairs of two pixels of each row, in the low and the high half
+		IMGDIFF_TARGET_SSE2
+		inline void SumColumns(__m128i s0, __m128i s1, __m128i& lo, __m128i& hi)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			lo = _mm_add_epi16(_mm_unpacklo_epi8(s0, zero), _mm_unpacklo_epi8(s1, zero));
+			hi = _mm_add_epi16(_mm_unpackhi_epi8(s0, zero), _mm_unpackhi_epi8(s1, zero));
+		}
+
+		// Averages of the pixel pairs of the column sums lo and hi, two pixels each
+		IMGDIFF_TARGET_SSE2
+		inline __m128i AveragePairs(__m128i lo, __m128i hi)
+		{
+			const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+			return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline void ReduceHalf(unsigned char *dst, const unsigned char *src0, const unsigned char *src1, unsigned width)
+		{
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				__m128i lo0, hi0, lo1, hi1;
+				SumColumns(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src0 + i * 8)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i *>(src1 + i * 8)), lo0, hi0);
+				SumColumns(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src0 + i * 8 + 16)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i *>(src1 + i * 8 + 16)), lo1, hi1);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4),
+					_mm_packus_epi16(AveragePairs(lo0, hi0), AveragePairs(lo1, hi1)));
+			}
+			Scalar::ReduceHalf(dst + i * 4, src0 + i * 8, src1 + i * 8, width - i);
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline __m128i QuantizeBytes(__m128i v, __m128i reciprocalv)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			return _mm_packus_epi16(_mm_mulhi_epu16(_mm_unpacklo_epi8(v, zero), reciprocalv),
+				_mm_mulhi_epu16(_mm_unpackhi_epi8(v, zero), reciprocalv));
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline __m128i HashWords(__m128i acc, __m128i d, __m128i key)
+		{
+			const __m128i k = _mm_xor_si128(d, key);
+			return _mm_add_epi64(acc, _mm_add_epi64(d, _mm_mul_epu32(k, _mm_srli_epi64(k, 32))));
+		}
+
+		IMGDIFF_TARGET_SSE2
+		inline uint64_t HashLine(const unsigned char *scanline, unsigned width, uint32_t channelMask, unsigned quantum)
+		{
+			const unsigned reciprocal = LineHashReciprocal(quantum);
+			const __m128i maskv = _mm_set1_epi32(static_cast<int>(channelMask));
+			const __m128i reciprocalv = _mm_set1_epi16(static_cast<short>(reciprocal));
+			const __m128i step0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(LINE_HASH_KEY_STEP));
+			const __m128i step1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(LINE_HASH_KEY_STEP + 2));
+			__m128i key0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(LINE_HASH_KEY));
+			__m128i key1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(LINE_HASH_KEY + 2));
+			__m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				__m128i d0 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(scanline + i * 4)), maskv);
+				__m128i d1 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(scanline + i * 4 + 16)), maskv);
+				if (reciprocal)
+				{
+					d0 = QuantizeBytes(d0, reciprocalv);
+					d1 = QuantizeBytes(d1, reciprocalv);
+				}
+				acc0 = HashWords(acc0, d0, key0);
+				acc1 = HashWords(acc1, d1, key1);
+				key0 = _mm_add_epi64(key0, step0);
+				key1 = _mm_add_epi64(key1, step1);
+			}
+			LineHashState state;
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(state.acc), acc0);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(state.acc + 2), acc1);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(state.key), key0);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(state.key + 2), key1);
+			return Scalar::FinishHashLine(state, scanline + i * 4, width - i, width, channelMask, reciprocal);
+		}
+	}
+
+	namespace AVX2
+	{
+		IMGDIFF_TARGET_AVX2
+		inline __m256i Weights(const ColorDistanceWeights& weights)
+		{
+			return _mm256_setr_epi16(
+				weights.b, weights.g, weights.r, weights.a, weights.b, weights.g, weights.r, weights.a,
+				weights.b, weights.g, weights.r, weights.a, weights.b, weights.g, weights.r, weights.a);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline __m256i ColorDistance2x8(const unsigned char *p1, const unsigned char *p2, __m256i weightsv)
+		{
+			__m256i d0 = _mm256_sub_epi16(
+				_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p1))),
+				_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p2))));
+			__m256i d1 = _mm256_sub_epi16(
+				_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p1 + 16))),
+				_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p2 + 16))));
+			// hadd works per 128-bit lane, so the result comes out as pixels 0,1,4,5,2,3,6,7
+			__m256i s = _mm256_hadd_epi32(
+				_mm256_madd_epi16(_mm256_mullo_epi16(d0, weightsv), d0),
+				_mm256_madd_epi16(_mm256_mullo_epi16(d1, weightsv), d1));
+			return _mm256_permute4x64_epi64(s, _MM_SHUFFLE(3, 1, 2, 0));
+		}
+
+		template<class BlockIndex>
+		IMGDIFF_TARGET_AVX2
+		inline void MarkDiffBlocksExact(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks)
+		{
+			const BlockIndex blockIndex(blockSize);
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				__m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(scanline1 + i * 4));
+				__m256i p2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(scanline2 + i * 4));
+				unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(p1, p2))) & 0xff;
+				MarkDiffBlocksFromMask(mask, x + i, blockIndex, blocks);
+			}
+			Scalar::MarkDiffBlocksExact<BlockIndex>(scanline1 + i * 4, scanline2 + i * 4, width - i, x + i, blockSize, blocks);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline unsigned DiffMask8(const unsigned char *p1, const unsigned char *p2, __m256i thresholdv, __m256i weightsv)
+		{
+			__m256i dist2 = ColorDistance2x8(p1, p2, weightsv);
+			return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(dist2, thresholdv)));
+		}
+
+		template<class BlockIndex>
+		IMGDIFF_TARGET_AVX2
+		inline void MarkDiffBlocksThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks, int threshold2, const ColorDistanceWeights& weights)
+		{
+			const BlockIndex blockIndex(blockSize);
+			const __m256i thresholdv = _mm256_set1_epi32(threshold2);
+			const __m256i weightsv = Weights(weights);
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				unsigned mask = DiffMask8(scanline1 + i * 4, scanline2 + i * 4, thresholdv, weightsv);
+				MarkDiffBlocksFromMask(mask, x + i, blockIndex, blocks);
+			}
+			Scalar::MarkDiffBlocksThreshold<BlockIndex>(scanline1 + i * 4, scanline2 + i * 4, width - i, x + i, blockSize, blocks, threshold2, weights);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline bool EqualsThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, int threshold2, const ColorDistanceWeights& weights)
+		{
+			const __m256i thresholdv = _mm256_set1_epi32(threshold2);
+			const __m256i weightsv = Weights(weights);
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				if (DiffMask8(scanline1 + i * 4, scanline2 + i * 4, thresholdv, weightsv))
+					return false;
+			}
+			return Scalar::EqualsThreshold(scanline1 + i * 4, scanline2 + i * 4, width - i, threshold2, weights);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline void OrMasks(const uint64_t *mask1, const uint64_t *mask2, uint64_t *result, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m256i m1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask1 + i));
+				__m256i m2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask2 + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(result + i), _mm256_or_si256(m1, m2));
+			}
+			Scalar::OrMasks(mask1 + i, mask2 + i, result + i, count - i);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline __m256i BlendFixedPoint(__m256i d, __m256i weightv, __m256i addendv)
+		{
+			return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(d, weightv), addendv), 8);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline bool BlendColor(unsigned char *pixels, unsigned width,
+			unsigned char b, unsigned char g, unsigned char r, unsigned alpha)
+		{
+			const short ialpha = static_cast<short>(256 - alpha);
+			const short ba = static_cast<short>(b * alpha), ga = static_cast<short>(g * alpha), ra = static_cast<short>(r * alpha);
+			const __m256i weightv = _mm256_setr_epi16(
+				ialpha, ialpha, ialpha, 256, ialpha, ialpha, ialpha, 256,
+				ialpha, ialpha, ialpha, 256, ialpha, ialpha, ialpha, 256);
+			const __m256i addendv = _mm256_setr_epi16(ba, ga, ra, 0, ba, ga, ra, 0, ba, ga, ra, 0, ba, ga, ra, 0);
+			const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+			const __m256i zero = _mm256_setzero_si256();
+			int transparent = 0;
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				__m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i * 4));
+				__m256i lo = BlendFixedPoint(_mm256_unpacklo_epi8(p, zero), weightv, addendv);
+				__m256i hi = BlendFixedPoint(_mm256_unpackhi_epi8(p, zero), weightv, addendv);
+				__m256i isTransparent = _mm256_cmpeq_epi32(_mm256_and_si256(p, alphaMask), zero);
+				__m256i blended = _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), p, isTransparent);
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i * 4), blended);
+				transparent |= _mm256_movemask_epi8(isTransparent);
+			}
+			return Scalar::BlendColor(pixels + i * 4, width - i, b, g, r, alpha) || transparent != 0;
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline void Blend(unsigned char *dst, const unsigned char *src, unsigned width, unsigned alpha)
+		{
+			const __m256i ialphav = _mm256_set1_epi16(static_cast<short>(256 - alpha));
+			const __m256i alphav = _mm256_set1_epi16(static_cast<short>(alpha));
+			const __m256i zero = _mm256_setzero_si256();
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i * 4));
+				__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+				__m256i lo = BlendFixedPoint(_mm256_unpacklo_epi8(d, zero), ialphav, _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), alphav));
+				__m256i hi = BlendFixedPoint(_mm256_unpackhi_epi8(d, zero), ialphav, _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), alphav));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_packus_epi16(lo, hi));
+			}
+			Scalar::Blend(dst + i * 4, src + i * 4, width - i, alpha);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline void XorColor(unsigned char *dst, const unsigned char *src, unsigned width)
+		{
+			const __m256i colorMask = _mm256_set1_epi32(0x00ffffff);
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i * 4));
+				__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_xor_si256(d, _mm256_and_si256(s, colorMask)));
+			}
+			Scalar::XorColor(dst + i * 4, src + i * 4, width - i);
+		}
+
+		// Same as SSE2::AveragePairs for the two 128-bit lanes of the rows s0 and s1
+		IMGDIFF_TARGET_AVX2
+		inline __m256i AveragePairs(__m256i s0, __m256i s1)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(s0, zero), _mm256_unpacklo_epi8(s1, zero));
+			const __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(s0, zero), _mm256_unpackhi_epi8(s1, zero));
+			const __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+			return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline void ReduceHalf(unsigned char *dst, const unsigned char *src0, const unsigned char *src1, unsigned width)
+		{
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				const __m256i a = AveragePairs(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src0 + i * 8)),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src1 + i * 8)));
+				const __m256i b = AveragePairs(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src0 + i * 8 + 32)),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src1 + i * 8 + 32)));
+				// the packing works within the lanes, which leaves the pixels in the order 0 1 4 5 2 3 6 7
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4),
+					_mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+			}
+			SSE2::ReduceHalf(dst + i * 4, src0 + i * 8, src1 + i * 8, width - i);
+		}
+
+		// the unpacking and the packing both work within the lanes, so the bytes stay in order
+		IMGDIFF_TARGET_AVX2
+		inline __m256i QuantizeBytes(__m256i v, __m256i reciprocalv)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			return _mm256_packus_epi16(_mm256_mulhi_epu16(_mm256_unpacklo_epi8(v, zero), reciprocalv),
+				_mm256_mulhi_epu16(_mm256_unpackhi_epi8(v, zero), reciprocalv));
+		}
+
+		IMGDIFF_TARGET_AVX2
+		inline uint64_t HashLine(const unsigned char *scanline, unsigned width, uint32_t channelMask, unsigned quantum)
+		{
+			const unsigned reciprocal = LineHashReciprocal(quantum);
+			const __m256i maskv = _mm256_set1_epi32(static_cast<int>(channelMask));
+			const __m256i reciprocalv = _mm256_set1_epi16(static_cast<short>(reciprocal));
+			const __m256i step = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(LINE_HASH_KEY_STEP));
+			__m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(LINE_HASH_KEY));
+			__m256i acc = _mm256_setzero_si256();
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				__m256i d = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(scanline + i * 4)), maskv);
+				if (reciprocal)
+					d = QuantizeBytes(d, reciprocalv);
+				const __m256i k = _mm256_xor_si256(d, key);
+				acc = _mm256_add_epi64(acc, _mm256_add_epi64(d, _mm256_mul_epu32(k, _mm256_srli_epi64(k, 32))));
+				key = _mm256_add_epi64(key, step);
+			}
+			LineHashState state;
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(state.acc), acc);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(state.key), key);
+			return Scalar::FinishHashLine(state, scanline + i * 4, width - i, width, channelMask, reciprocal);
+		}
+	}
+#endif
+
+#ifdef IMGDIFF_KERNELS_NEON
+	namespace NEON
+	{
+		inline unsigned MaskFromLanes(uint32x4_t lanes)
+		{
+			if (vmaxvq_u32(lanes) == 0)
+				return 0;
+			return (vgetq_lane_u32(lanes, 0) & 1) | (vgetq_lane_u32(lanes, 1) & 2) |
+			       (vgetq_lane_u32(lanes, 2) & 4) | (vgetq_lane_u32(lanes, 3) & 8);
+		}
+
+		inline int16x8_t Weights(const ColorDistanceWeights& weights)
+		{
+			const int16_t w[8] = { weights.b, weights.g, weights.r, weights.a, weights.b, weights.g, weights.r, weights.a };
+			return vld1q_s16(w);
+		}
+
+		inline int32x4_t ColorDistance2x4(uint8x16_t p1, uint8x16_t p2, int16x8_t weightsv)
+		{
+			int16x8_t d01 = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(p1), vget_low_u8(p2)));
+			int16x8_t d23 = vreinterpretq_s16_u16(vsubl_high_u8(p1, p2));
+			int16x8_t w01 = vmulq_s16(d01, weightsv);
+			int16x8_t w23 = vmulq_s16(d23, weightsv);
+			int32x4_t s01 = vpaddq_s32(vmull_s16(vget_low_s16(w01), vget_low_s16(d01)), vmull_high_s16(w01, d01));
+			int32x4_t s23 = vpaddq_s32(vmull_s16(vget_low_s16(w23), vget_low_s16(d23)), vmull_high_s16(w23, d23));
+			return vpaddq_s32(s01, s23);
+		}
+
+		inline unsigned DiffMask4(const unsigned char *p1, const unsigned char *p2, int32x4_t thresholdv, int16x8_t weightsv)
+		{
+			int32x4_t dist2 = ColorDistance2x4(vld1q_u8(p1), vld1q_u8(p2), weightsv);
+			return MaskFromLanes(vcgtq_s32(dist2, thresholdv));
+		}
+
+		template<class BlockIndex>
+		inline void MarkDiffBlocksExact(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks)
+		{
+			const BlockIndex blockIndex(blockSize);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				uint32x4_t p1 = vreinterpretq_u32_u8(vld1q_u8(scanline1 + i * 4));
+				uint32x4_t p2 = vreinterpretq_u32_u8(vld1q_u8(scanline2 + i * 4));
+				unsigned mask = MaskFromLanes(vmvnq_u32(vceqq_u32(p1, p2)));
+				MarkDiffBlocksFromMask(mask, x + i, blockIndex, blocks);
+			}
+			Scalar::MarkDiffBlocksExact<BlockIndex>(scanline1 + i * 4, scanline2 + i * 4, width - i, x + i, blockSize, blocks);
+		}
+
+		template<class BlockIndex>
+		inline void MarkDiffBlocksThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, unsigned x, unsigned blockSize, int *blocks, int threshold2, const ColorDistanceWeights& weights)
+		{
+			const BlockIndex blockIndex(blockSize);
+			const int32x4_t thresholdv = vdupq_n_s32(threshold2);
+			const int16x8_t weightsv = Weights(weights);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				unsigned mask = DiffMask4(scanline1 + i * 4, scanline2 + i * 4, thresholdv, weightsv);
+				MarkDiffBlocksFromMask(mask, x + i, blockIndex, blocks);
+			}
+			Scalar::MarkDiffBlocksThreshold<BlockIndex>(scanline1 + i * 4, scanline2 + i * 4, width - i, x + i, blockSize, blocks, threshold2, weights);
+		}
+
+		inline bool EqualsThreshold(const unsigned char *scanline1, const unsigned char *scanline2,
+			unsigned width, int threshold2, const ColorDistanceWeights& weights)
+		{
+			const int32x4_t thresholdv = vdupq_n_s32(threshold2);
+			const int16x8_t weightsv = Weights(weights);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				if (DiffMask4(scanline1 + i * 4, scanline2 + i * 4, thresholdv, weightsv))
+					return false;
+			}
+			return Scalar::EqualsThreshold(scanline1 + i * 4, scanline2 + i * 4, width - i, threshold2, weights);
+		}
+
+		inline void OrMasks(const uint64_t *mask1, const uint64_t *mask2, uint64_t *result, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2)
+				vst1q_u64(result + i, vorrq_u64(vld1q_u64(mask1 + i), vld1q_u64(mask2 + i)));
+			Scalar::OrMasks(mask1 + i, mask2 + i, result + i, count - i);
+		}
+
+		inline uint8x16_t BlendFixedPoint(uint8x16_t d, uint16x8_t weightv, uint16x8_t addendLo, uint16x8_t addendHi)
+		{
+			uint16x8_t lo = vshrq_n_u16(vmlaq_u16(addendLo, vmovl_u8(vget_low_u8(d)), weightv), 8);
+			uint16x8_t hi = vshrq_n_u16(vmlaq_u16(addendHi, vmovl_high_u8(d), weightv), 8);
+			return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+		}
+
+		inline bool BlendColor(unsigned char *pixels, unsigned width,
+			unsigned char b, unsigned char g, unsigned char r, unsigned alpha)
+		{
+			const uint16_t ialpha = static_cast<uint16_t>(256 - alpha);
+			const uint16_t ba = static_cast<uint16_t>(b * alpha), ga = static_cast<uint16_t>(g * alpha), ra = static_cast<uint16_t>(r * alpha);
+			const uint16_t w[8] = { ialpha, ialpha, ialpha, 256, ialpha, ialpha, ialpha, 256 };
+			const uint16_t a[8] = { ba, ga, ra, 0, ba, ga, ra, 0 };
+			const uint16x8_t weightv = vld1q_u16(w);
+			const uint16x8_t addendv = vld1q_u16(a);
+			const uint32x4_t alphaMask = vdupq_n_u32(0xff000000);
+			uint32x4_t transparent = vdupq_n_u32(0);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				uint8x16_t p = vld1q_u8(pixels + i * 4);
+				uint32x4_t isTransparent = vceqq_u32(vandq_u32(vreinterpretq_u32_u8(p), alphaMask), vdupq_n_u32(0));
+				uint8x16_t blended = vbslq_u8(vreinterpretq_u8_u32(isTransparent), p, BlendFixedPoint(p, weightv, addendv, addendv));
+				vst1q_u8(pixels + i * 4, blended);
+				transparent = vorrq_u32(transparent, isTransparent);
+			}
+			return Scalar::BlendColor(pixels + i * 4, width - i, b, g, r, alpha) || vmaxvq_u32(transparent) != 0;
+		}
+
+		inline void Blend(unsigned char *dst, const unsigned char *src, unsigned width, unsigned alpha)
+		{
+			const uint16x8_t ialphav = vdupq_n_u16(static_cast<uint16_t>(256 - alpha));
+			const uint16x8_t alphav = vdupq_n_u16(static_cast<uint16_t>(alpha));
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				uint8x16_t s = vld1q_u8(src + i * 4);
+				uint16x8_t addendLo = vmulq_u16(vmovl_u8(vget_low_u8(s)), alphav);
+				uint16x8_t addendHi = vmulq_u16(vmovl_high_u8(s), alphav);
+				vst1q_u8(dst + i * 4, BlendFixedPoint(vld1q_u8(dst + i * 4), ialphav, addendLo, addendHi));
+			}
+			Scalar::Blend(dst + i * 4, src + i * 4, width - i, alpha);
+		}
+
+		inline void XorColor(unsigned char *dst, const unsigned char *src, unsigned width)
+		{
+			const uint32x4_t colorMask = vdupq_n_u32(0x00ffffff);
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				uint32x4_t d = vreinterpretq_u32_u8(vld1q_u8(dst + i * 4));
+				uint32x4_t s = vreinterpretq_u32_u8(vld1q_u8(src + i * 4));
+				vst1q_u8(dst + i * 4, vreinterpretq_u8_u32(veorq_u32(d, vandq_u32(s, colorMask))));
+			}
+			Scalar::XorColor(dst + i * 4, src + i * 4, width - i);
+		}
+
+		// Sums of the 2x2 pixels of two pixels of each of the rows s0 and s1
+		inline uint16x8_t SumQuads(uint8x16_t s0, uint8x16_t s1)
+		{
+			const uint16x8_t lo = vaddl_u8(vget_low_u8(s0), vget_low_u8(s1));
+			const uint16x8_t hi = vaddl_high_u8(s0, s1);
+			return vcombine_u16(vadd_u16(vget_low_u16(lo), vget_high_u16(lo)), vadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+		}
+
+		inline void ReduceHalf(unsigned char *dst, const unsigned char *src0, const unsigned char *src1, unsigned width)
+		{
+			unsigned i = 0;
+			for (; i + 4 <= width; i += 4)
+			{
+				const uint16x8_t a = SumQuads(vld1q_u8(src0 + i * 8), vld1q_u8(src1 + i * 8));
+				const uint16x8_t b = SumQuads(vld1q_u8(src0 + i * 8 + 16), vld1q_u8(src1 + i * 8 + 16));
+				vst1q_u8(dst + i * 4, vcombine_u8(vrshrn_n_u16(a, 2), vrshrn_n_u16(b, 2)));
+			}
+			Scalar::ReduceHalf(dst + i * 4, src0 + i * 8, src1 + i * 8, width - i);
+		}
+
+		inline uint8x16_t QuantizeBytes(uint8x16_t v, uint16x4_t reciprocalv)
+		{
+			const uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+			const uint16x8_t hi = vmovl_high_u8(v);
+			const uint16x8_t qlo = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(lo), reciprocalv), 16),
+				vshrn_n_u32(vmull_u16(vget_high_u16(lo), reciprocalv), 16));
+			const uint16x8_t qhi = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(hi), reciprocalv), 16),
+				vshrn_n_u32(vmull_u16(vget_high_u16(hi), reciprocalv), 16));
+			return vcombine_u8(vmovn_u16(qlo), vmovn_u16(qhi));
+		}
+
+		inline uint64x2_t HashWords(uint64x2_t acc, uint64x2_t d, uint64x2_t key)
+		{
+			const uint64x2_t k = veorq_u64(d, key);
+			return vaddq_u64(acc, vaddq_u64(d, vmull_u32(vmovn_u64(k), vshrn_n_u64(k, 32))));
+		}
+
+		inline uint64_t HashLine(const unsigned char *scanline, unsigned width, uint32_t channelMask, unsigned quantum)
+		{
+			const unsigned reciprocal = LineHashReciprocal(quantum);
+			const uint8x16_t maskv = vreinterpretq_u8_u32(vdupq_n_u32(channelMask));
+			const uint16x4_t reciprocalv = vdup_n_u16(static_cast<uint16_t>(reciprocal));
+			const uint64x2_t step0 = vld1q_u64(LINE_HASH_KEY_STEP), step1 = vld1q_u64(LINE_HASH_KEY_STEP + 2);
+			uint64x2_t key0 = vld1q_u64(LINE_HASH_KEY), key1 = vld1q_u64(LINE_HASH_KEY + 2);
+			uint64x2_t acc0 = vdupq_n_u64(0), acc1 = vdupq_n_u64(0);
+			unsigned i = 0;
+			for (; i + 8 <= width; i += 8)
+			{
+				uint8x16_t d0 = vandq_u8(vld1q_u8(scanline + i * 4), maskv);
+				uint8x16_t d1 = vandq_u8(vld1q_u8(scanline + i * 4 + 16), maskv);
+				if (reciprocal)
+				{
+					d0 = QuantizeBytes(d0, reciprocalv);
+					d1 = QuantizeBytes(d1, reciprocalv);
+				}
+				acc0 = HashWords(acc0, vreinterpretq_u64_u8(d0), key0);
+				acc1 = HashWords(acc1, vreinterpretq_u64_u8(d1), key1);
+				key0 = vaddq_u64(key0, step0);
+				key1 = vaddq_u64(key1, step1);
+			}
+			LineHashState state;
+			vst1q_u64(state.acc, acc0);
+			vst1q_u64(state.acc + 2, acc1);
+			vst1q_u64(state.key, key0);
+			vst1q_u64(state.key + 2, key1);
+			return Scalar::FinishHashLine(state, scanline + i * 4, width - i, width, channelMask, reciprocal);
+		}
+	}
+#endif
+
+	inline bool IsSupported(ISA isa)
+	{
+		switch (isa)
+		{
+		case ISA_SCALAR:
+			return true;
+#ifdef IMGDIFF_KERNELS_X86
+		case ISA_SSE2:
+		case ISA_AVX2:
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			const int nIds = info[0];
+			__cpuid(info, 1);
+			if (isa == ISA_SSE2)
+				return (info[3] & (1 << 26)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (nIds < 7 || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return isa == ISA_SSE2 ? !!__builtin_cpu_supports("sse2") : !!__builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+#ifdef IMGDIFF_KERNELS_NEON
+		case ISA_NEON:
+			return true;
+#endif
+		default:
+			return false;
+		}
+	}
+
+	// Returns the kernels for the given instruction set, falling back to the scalar ones
+	// when the instruction set is not available on this CPU.
+	inline Kernels GetKernels(ISA isa)
+	{
+		if (IsSupported(isa))
+		{
+			switch (isa)
+			{
+#ifdef IMGDIFF_KERNELS_X86
+			case ISA_SSE2:
+				return { ISA_SSE2,
+					SSE2::MarkDiffBlocksExact<BlockIndexDiv>, SSE2::MarkDiffBlocksThreshold<BlockIndexDiv>,
+					SSE2::MarkDiffBlocksExact<BlockIndexShift>, SSE2::MarkDiffBlocksThreshold<BlockIndexShift>,
+					SSE2::EqualsThreshold, SSE2::OrMasks,
+					SSE2::BlendColor, SSE2::Blend, SSE2::XorColor, SSE2::ReduceHalf, SSE2::HashLine };
+			case ISA_AVX2:
+				return { ISA_AVX2,
+					AVX2::MarkDiffBlocksExact<BlockIndexDiv>, AVX2::MarkDiffBlocksThreshold<BlockIndexDiv>,
+					AVX2::MarkDiffBlocksExact<BlockIndexShift>, AVX2::MarkDiffBlocksThreshold<BlockIndexShift>,
+					AVX2::EqualsThreshold, AVX2::OrMasks,
+					AVX2::BlendColor, AVX2::Blend, AVX2::XorColor, AVX2::ReduceHalf, AVX2::HashLine };
+#endif
+#ifdef IMGDIFF_KERNELS_NEON
+			case ISA_NEON:
+				return { ISA_NEON,
+					NEON::MarkDiffBlocksExact<BlockIndexDiv>, NEON::MarkDiffBlocksThreshold<BlockIndexDiv>,
+					NEON::MarkDiffBlocksExact<BlockIndexShift>, NEON::MarkDiffBlocksThreshold<BlockIndexShift>,
+					NEON::EqualsThreshold, NEON::OrMasks,
+					NEON::BlendColor, NEON::Blend, NEON::XorColor, NEON::ReduceHalf, NEON::HashLine };
+#endif
+			default:
+				break;
+			}
+		}
+		return { ISA_SCALAR,
+					Scalar::MarkDiffBlocksExact<BlockIndexDiv>, Scalar::MarkDiffBlocksThreshold<BlockIndexDiv>,
+					Scalar::MarkDiffBlocksExact<BlockIndexShift>, Scalar::MarkDiffBlocksThreshold<BlockIndexShift>,
+					Scalar::EqualsThreshold, Scalar::OrMasks,
+					Scalar::BlendColor, Scalar::Blend, Scalar::XorColor, Scalar::ReduceHalf, Scalar::HashLine };
+	}
+
+	// The best kernels for this CPU, selected once at first use.
+	inline const Kernels& GetKernels()
+	{
+		static const Kernels kernels = []() {
+			const ISA candidates[] = { ISA_AVX2, ISA_NEON, ISA_SSE2 };
+			for (ISA isa : candidates)
+			{
+				if (IsSupported(isa))
+					return GetKernels(isa);
+			}
+			return GetKernels(ISA_SCALAR);
+		}();
+		return kernels;
+	}
+}
@@ -0,0 +1,203 @@
+// Times the blend passes of compositing a frame: the diff highlight of MarkDiff and the
+// overlay of AlphaBlendImages2, with the per-pixel double arithmetic they used before the
+// fixed-point kernels and with the kernels of every instruction set the CPU supports.
+// The loops are those of CImgDiffBuffer on plain buffers, so no image library is needed.
+#include "ImgDiffKernels.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace ImgDiffKernels;
+
+namespace
+{
+	const unsigned BLOCK_SIZE = 8;
+	const double DIFF_COLOR_ALPHA = 0.7;
+	const double OVERLAY_ALPHA = 0.3;
+	const unsigned char DIFF_B = 0, DIFF_G = 0, DIFF_R = 255;
+
+	struct Canvas
+	{
+		unsigned width, height;
+		std::vector<unsigned char> pixels;
+		unsigned char *scanLine(unsigned y) { return &pixels[static_cast<size_t>(y) * width * 4]; }
+		const unsigned char *scanLine(unsigned y) const { return &pixels[static_cast<size_t>(y) * width * 4]; }
+	};
+
+	// A run of blocks of one diff in a row of blocks, as in DiffBlocks
+	struct Run
+	{
+		unsigned x, length;
+		int value;
+	};
+
+	Canvas RandomCanvas(unsigned width, unsigned height, std::mt19937& rng)
+	{
+		Canvas canvas{ width, height, std::vector<unsigned char>(static_cast<size_t>(width) * height * 4) };
+		for (auto& c : canvas.pixels)
+			c = static_cast<unsigned char>(rng());
+		// about one pixel in a hundred is fully transparent
+		for (size_t i = 3; i < canvas.pixels.size(); i += 4)
+			canvas.pixels[i] = rng() % 100 == 0 ? 0 : 255;
+		return canvas;
+	}
+
+	// Rows of runs where about half the blocks belong to a diff
+	std::vector<std::vector<Run>> RandomDiff(unsigned bwidth, unsigned bheight, std::mt19937& rng)
+	{
+		std::vector<std::vector<Run>> rows(bheight);
+		for (auto& row : rows)
+		{
+			for (unsigned x = 0; x < bwidth; )
+			{
+				const unsigned length = (std::min)(1 + static_cast<unsigned>(rng() % 64), bwidth - x);
+				row.push_back({ x, length, rng() % 2 ? 1 : 0 });
+				x += length;
+			}
+		}
+		return rows;
+	}
+
+	// MarkDiff before the kernels: every block of a run blended pixel by pixel in double
+	void MarkDiffDouble(const std::vector<std::vector<Run>>& diff, Canvas& dst)
+	{
+		for (unsigned by = 0; by < diff.size(); ++by)
+		{
+			for (const auto& run : diff[by])
+			{
+				for (unsigned bx = run.x; bx < run.x + run.length; ++bx)
+				{
+					if (run.value == 0)
+						continue;
+					const unsigned ymax = (std::min)((by + 1) * BLOCK_SIZE, dst.height);
+					const unsigned xmax = (std::min)((bx + 1) * BLOCK_SIZE, dst.width);
+					for (unsigned y = by * BLOCK_SIZE; y < ymax; ++y)
+					{
+						unsigned char *scanline = dst.scanLine(y);
+						for (unsigned x = bx * BLOCK_SIZE; x < xmax; ++x)
+						{
+							if (scanline[x * 4 + 3] != 0)
+							{
+								scanline[x * 4 + 0] = static_cast<unsigned char>(scanline[x * 4 + 0] * (1 - DIFF_COLOR_ALPHA) + DIFF_B * DIFF_COLOR_ALPHA);
+								scanline[x * 4 + 1] = static_cast<unsigned char>(scanline[x * 4 + 1] * (1 - DIFF_COLOR_ALPHA) + DIFF_G * DIFF_COLOR_ALPHA);
+								scanline[x * 4 + 2] = static_cast<unsigned char>(scanline[x * 4 + 2] * (1 - DIFF_COLOR_ALPHA) + DIFF_R * DIFF_COLOR_ALPHA);
+							}
+							else
+							{
+								scanline[x * 4 + 0] = DIFF_B;
+								scanline[x * 4 + 1] = DIFF_G;
+								scanline[x * 4 + 2] = DIFF_R;
+								scanline[x * 4 + 3] = static_cast<unsigned char>(0xff * DIFF_COLOR_ALPHA);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// MarkDiff with the kernels: a run blended a scanline span at a time, and the transparent
+	// pixels filled in only on the spans blendColor reports having them
+	void MarkDiffKernel(const Kernels& k, const std::vector<std::vector<Run>>& diff, Canvas& dst)
+	{
+		const unsigned alpha = FixedPointAlpha(DIFF_COLOR_ALPHA);
+		const unsigned char transparentAlpha = static_cast<unsigned char>(0xff * DIFF_COLOR_ALPHA);
+		for (unsigned by = 0; by < diff.size(); ++by)
+		{
+			const unsigned ymax = (std::min)((by + 1) * BLOCK_SIZE, dst.height);
+			for (const auto& run : diff[by])
+			{
+				if (run.value == 0)
+					continue;
+				const unsigned xmin = run.x * BLOCK_SIZE;
+				const unsigned xmax = (std::min)((run.x + run.length) * BLOCK_SIZE, dst.width);
+				for (unsigned y = by * BLOCK_SIZE; y < ymax; ++y)
+				{
+					unsigned char *scanline = dst.scanLine(y);
+					if (!k.blendColor(scanline + xmin * 4, xmax - xmin, DIFF_B, DIFF_G, DIFF_R, alpha))
+						continue;
+					for (unsigned x = xmin; x < xmax; ++x)
+					{
+						if (scanline[x * 4 + 3] != 0)
+							continue;
+						scanline[x * 4 + 0] = DIFF_B;
+						scanline[x * 4 + 1] = DIFF_G;
+						scanline[x * 4 + 2] = DIFF_R;
+						scanline[x * 4 + 3] = transparentAlpha;
+					}
+				}
+			}
+		}
+	}
+
+	// AlphaBlendImages2 before the kernels
+	void OverlayDouble(const Canvas& src, Canvas& dst)
+	{
+		for (unsigned y = 0; y < dst.height; ++y)
+		{
+			const unsigned char *scanline_src = src.scanLine(y);
+			unsigned char *scanline_dst = dst.scanLine(y);
+			for (unsigned x = 0; x < dst.width; ++x)
+			{
+				for (unsigned c = 0; c < 4; ++c)
+					scanline_dst[x * 4 + c] = static_cast<unsigned char>(scanline_dst[x * 4 + c] * (1 - OVERLAY_ALPHA) + scanline_src[x * 4 + c] * OVERLAY_ALPHA);
+			}
+		}
+	}
+
+	void OverlayKernel(const Kernels& k, const Canvas& src, Canvas& dst)
+	{
+		const unsigned alpha = FixedPointAlpha(OVERLAY_ALPHA);
+		for (unsigned y = 0; y < dst.height; ++y)
+			k.blend(dst.scanLine(y), src.scanLine(y), dst.width, alpha);
+	}
+
+	// The best of a few runs of pass on a fresh copy of canvas, in milliseconds
+	template<typename Pass>
+	double Time(const Canvas& canvas, Pass pass)
+	{
+		double best = 0;
+		for (int i = 0; i < 9; ++i)
+		{
+			Canvas dst(canvas);
+			const auto start = std::chrono::steady_clock::now();
+			pass(dst);
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (i == 0 || ms < best)
+				best = ms;
+		}
+		return best;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned width = argc > 2 ? static_cast<unsigned>(atoi(argv[1])) : 4000;
+	const unsigned height = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : 3000;
+	std::mt19937 rng(1);
+	const Canvas canvas = RandomCanvas(width, height, rng);
+	const Canvas overlay = RandomCanvas(width, height, rng);
+	const auto diff = RandomDiff((width + BLOCK_SIZE - 1) / BLOCK_SIZE, (height + BLOCK_SIZE - 1) / BLOCK_SIZE, rng);
+
+	printf("%ux%u canvas, %u-pixel blocks, best of 9 runs\n", width, height, BLOCK_SIZE);
+	printf("%-8s %12s %12s\n", "", "MarkDiff", "overlay");
+	const double markDiffDouble = Time(canvas, [&](Canvas& dst) { MarkDiffDouble(diff, dst); });
+	const double overlayDouble = Time(canvas, [&](Canvas& dst) { OverlayDouble(overlay, dst); });
+	printf("%-8s %9.1f ms %9.1f ms\n", "double", markDiffDouble, overlayDouble);
+	const ISA isas[] = { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_NEON };
+	const char *names[] = { "scalar", "SSE2", "AVX2", "NEON" };
+	for (ISA isa : isas)
+	{
+		const Kernels k = GetKernels(isa);
+		if (k.isa != isa)
+			continue;
+		const double markDiff = Time(canvas, [&](Canvas& dst) { MarkDiffKernel(k, diff, dst); });
+		const double overlayBlend = Time(canvas, [&](Canvas& dst) { OverlayKernel(k, overlay, dst); });
+		printf("%-8s %9.1f ms %9.1f ms  (%.1fx, %.1fx)\n", names[isa], markDiff, overlayBlend,
+			markDiffDouble / markDiff, overlayDouble / overlayBlend);
+	}
+	return 0;
+}
@@ -6,6 +6,10 @@
 #endif
 #include <iostream>
 #include <clocale>
+#include <cstring>
+
+// exit status of the -q mode
+enum { EXIT_IDENTICAL = 0, EXIT_DIFFERENT = 1, EXIT_TROUBLE = 2 };
 
 int main(int argc, char* argv[])
 {
@@ -15,16 +19,25 @@ int main(int argc, char* argv[])
 	wchar_t filenameW[2][260];
 	const wchar_t *filenames[2] = { filenameW[0], filenameW[1] };
 
-	if (argc < 3)
+	// -q: only report whether the images differ through the exit status, without writing diff.png
+	bool quiet = false;
+	int argi = 1;
+	if (argc > 1 && strcmp(argv[1], "-q") == 0)
 	{
-		std::wcerr << L"usage: cmdidiff image_file1 image_file2" << std::endl;
-		exit(1);
+		quiet = true;
+		++argi;
+	}
+
+	if (argc - argi < 2)
+	{
+		std::wcerr << L"usage: cmdidiff [-q] image_file1 image_file2" << std::endl;
+		exit(quiet ? EXIT_TROUBLE : 1);
 	}
 
 	setlocale(LC_ALL, "");
 
-	mbstowcs(filenameW[0], argv[1], strlen(argv[1]) + 1);
-	mbstowcs(filenameW[1], argv[2], strlen(argv[2]) + 1);
+	mbstowcs(filenameW[0], argv[argi], strlen(argv[argi]) + 1);
+	mbstowcs(filenameW[1], argv[argi + 1], strlen(argv[argi + 1]) + 1);
 
 #ifdef USE_WINIMERGELIB
 	IImgMergeWindow *pImgMergeWindow = WinIMerge_CreateWindowless();
@@ -33,7 +46,14 @@ int main(int argc, char* argv[])
 		if (!pImgMergeWindow->OpenImages(filenames[0], filenames[1]))
 		{
 			std::wcerr << L"cmdidiff: could not open files. (" << filenameW[0] << ", " << filenameW[1] << L")" << std::endl;
-			exit(1);
+			exit(quiet ? EXIT_TROUBLE : 1);
+		}
+		if (quiet)
+		{
+			// the DLL interface has no identical check, OpenImages has already compared the images
+			const int diffCount = pImgMergeWindow->GetDiffCount();
+			WinIMerge_DestroyWindow(pImgMergeWindow);
+			return diffCount == 0 ? EXIT_IDENTICAL : EXIT_DIFFERENT;
 		}
 		pImgMergeWindow->SaveDiffImageAs(1, L"diff.png");
 		WinIMerge_DestroyWindow(pImgMergeWindow);
@@ -44,7 +64,14 @@ int main(int argc, char* argv[])
 	if (!buffer.OpenImages(2, filenames))
 	{
 		std::wcerr << L"cmdidiff: could not open files. (" << filenameW[0] << ", " << filenameW[1] << L")" << std::endl;
-		exit(1);
+		exit(quiet ? EXIT_TROUBLE : 1);
+	}
+
+	if (quiet)
+	{
+		const bool identical = buffer.AreImagesIdentical();
+		buffer.CloseImages();
+		return identical ? EXIT_IDENTICAL : EXIT_DIFFERENT;
 	}
 
 	buffer.CompareImages();
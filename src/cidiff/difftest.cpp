@@ -0,0 +1,220 @@
+// Checks that Diff gives the same edit script with the row hashes passed in as with the
+// hashes it computes itself, for all the algorithms. Patience and histogram diff ranges
+// of records separately, which exercises the hashes of sub-ranges. Also checks that the
+// cost limit of setLimits() still gives a valid edit script and reports truncated().
+#include <climits>
+#include <cstring>
+#include "Diff.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const unsigned ROW_SIZE = 4;
+	const int ITERATIONS = 2000;
+
+	// Rows of ROW_SIZE bytes one after another
+	class Rows
+	{
+	public:
+		explicit Rows(const std::vector<unsigned>& values)
+			: m_bytes(values.size() * ROW_SIZE)
+		{
+			for (size_t i = 0; i < values.size(); ++i)
+				memcpy(&m_bytes[i * ROW_SIZE], &values[i], ROW_SIZE);
+		}
+		unsigned size() const { return static_cast<unsigned>(m_bytes.size()); }
+		const char* data() const { return m_bytes.empty() ? nullptr : m_bytes.data(); }
+		const char* next(const char* row) const { return row + ROW_SIZE; }
+		unsigned rowSize(const char*) const { return ROW_SIZE; }
+		bool equals(const char* row1, unsigned, const char* row2, unsigned) const
+		{
+			return memcmp(row1, row2, ROW_SIZE) == 0;
+		}
+		unsigned long hash(const char* row) const
+		{
+			unsigned value;
+			memcpy(&value, row, ROW_SIZE);
+			return value * 2654435761u;
+		}
+		std::vector<unsigned long> hashes() const
+		{
+			std::vector<unsigned long> result;
+			for (const char *row = data(), *end = data() + size(); row < end; row = next(row))
+				result.push_back(hash(row));
+			return result;
+		}
+
+	private:
+		std::vector<char> m_bytes;
+	};
+
+	std::mt19937 rng(20240607);
+
+	unsigned Random(unsigned n)
+	{
+		return static_cast<unsigned>(rng() % n);
+	}
+
+	// Mostly rows repeated from a few values, so that patience has to fall back, with some
+	// unique rows for it to anchor on. Histogram falls back only where a row repeats more
+	// than 64 times, so long inputs get runs of few values.
+	std::vector<unsigned> RandomRows(unsigned count, unsigned& unique)
+	{
+		std::vector<unsigned> rows(count);
+		for (unsigned i = 0; i < count; ++i)
+			rows[i] = (i / 300) % 2 == 1 ? Random(2) : (Random(6) == 0 ? 1000 + unique++ : Random(4));
+		return rows;
+	}
+
+	std::vector<unsigned> Edit(const std::vector<unsigned>& rows, unsigned& unique)
+	{
+		std::vector<unsigned> result;
+		for (unsigned row : rows)
+		{
+			switch (Random(10))
+			{
+			case 0: break;
+			case 1: result.push_back(Random(4)); break;
+			case 2: result.push_back(row); result.push_back(1000 + unique++); break;
+			default: result.push_back(row); break;
+			}
+		}
+		return result;
+	}
+
+	// Whether edscript turns values1 into values2: the rows it keeps are equal, and it uses up
+	// both sides
+	bool Transforms(const std::vector<char>& edscript, const std::vector<unsigned>& values1, const std::vector<unsigned>& values2)
+	{
+		size_t i1 = 0, i2 = 0;
+		for (char op : edscript)
+		{
+			switch (op)
+			{
+			case '=':
+				if (i1 >= values1.size() || i2 >= values2.size() || values1[i1] != values2[i2])
+					return false;
+				++i1; ++i2;
+				break;
+			case '!': ++i1; ++i2; break;
+			case '-': ++i1; break;
+			case '+': ++i2; break;
+			default: return false;
+			}
+		}
+		return i1 == values1.size() && i2 == values2.size();
+	}
+
+	const Diff<Rows>::Algorithm ALGORITHMS[] = { Diff<Rows>::MYERS, Diff<Rows>::MINIMAL, Diff<Rows>::PATIENCE, Diff<Rows>::HISTOGRAM };
+	const char *ALGORITHM_NAMES[] = { "MYERS", "MINIMAL", "PATIENCE", "HISTOGRAM" };
+	const size_t ALGORITHM_COUNT = sizeof(ALGORITHMS) / sizeof(ALGORITHMS[0]);
+
+	int TestCachedHashes()
+	{
+		int failures[ALGORITHM_COUNT] = {};
+		for (int iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			unsigned unique = 0;
+			const std::vector<unsigned> values1 = RandomRows(Random(2) ? Random(120) : 300 + Random(600), unique);
+			const Rows rows1(values1), rows2(Edit(values1, unique));
+			const std::vector<unsigned long> hashes1 = rows1.hashes(), hashes2 = rows2.hashes();
+			for (size_t i = 0; i < ALGORITHM_COUNT; ++i)
+			{
+				std::vector<char> edscript, edscriptCached;
+				Diff<Rows>(rows1, rows2).diff(ALGORITHMS[i], edscript);
+				Diff<Rows>(rows1, rows2, hashes1.data(), hashes2.data()).diff(ALGORITHMS[i], edscriptCached);
+				if (edscript != edscriptCached)
+					++failures[i];
+			}
+		}
+		int total = 0;
+		for (size_t i = 0; i < ALGORITHM_COUNT; ++i)
+		{
+			if (failures[i])
+				printf("%s: edit scripts differ with cached hashes in %d of %d diffs\n", ALGORITHM_NAMES[i], failures[i], ITERATIONS);
+			total += failures[i];
+		}
+		return total;
+	}
+
+	// Rows that are all different, and a copy with chunks of them shuffled. Rows that match
+	// nothing would be discarded before the diff, so all rows appear on both sides and the
+	// minimal diff costs far more than a small cost limit.
+	void RandomUniqueRows(std::vector<unsigned>& values1, std::vector<unsigned>& values2)
+	{
+		values1.resize(200 + Random(300));
+		for (size_t i = 0; i < values1.size(); ++i)
+			values1[i] = static_cast<unsigned>(i);
+		std::vector<std::vector<unsigned>> chunks;
+		for (size_t i = 0; i < values1.size(); )
+		{
+			const size_t length = (std::min)(static_cast<size_t>(1 + Random(20)), values1.size() - i);
+			chunks.emplace_back(values1.begin() + i, values1.begin() + i + length);
+			i += length;
+		}
+		std::shuffle(chunks.begin(), chunks.end(), rng);
+		values2.clear();
+		for (const auto& chunk : chunks)
+			values2.insert(values2.end(), chunk.begin(), chunk.end());
+	}
+
+	int TestLimits()
+	{
+		const long SMALL_COST = 8, LARGE_COST = 1L << 30;
+		int failures = 0;
+		for (int iteration = 0; iteration < ITERATIONS / 10; ++iteration)
+		{
+			std::vector<unsigned> values1, values2;
+			RandomUniqueRows(values1, values2);
+			const Rows rows1(values1), rows2(values2);
+
+			std::vector<char> edscript;
+			Diff<Rows> limited(rows1, rows2);
+			limited.setLimits(SMALL_COST, 0);
+			limited.diff(Diff<Rows>::MINIMAL, edscript);
+			if (!limited.truncated())
+			{
+				printf("MINIMAL: not truncated at a cost limit of %ld, iteration %d\n", SMALL_COST, iteration);
+				++failures;
+			}
+			if (!Transforms(edscript, values1, values2))
+			{
+				printf("MINIMAL: invalid edit script at a cost limit of %ld, iteration %d\n", SMALL_COST, iteration);
+				++failures;
+			}
+
+			for (size_t i = 0; i < ALGORITHM_COUNT; ++i)
+			{
+				std::vector<char> edscriptUnlimited, edscriptZero, edscriptLarge;
+				Diff<Rows>(rows1, rows2).diff(ALGORITHMS[i], edscriptUnlimited);
+				Diff<Rows> zero(rows1, rows2);
+				zero.setLimits(0, 0);
+				zero.diff(ALGORITHMS[i], edscriptZero);
+				if (edscriptZero != edscriptUnlimited || zero.truncated())
+				{
+					printf("%s: limits of 0 change the diff, iteration %d\n", ALGORITHM_NAMES[i], iteration);
+					++failures;
+				}
+				Diff<Rows> large(rows1, rows2);
+				large.setLimits(LARGE_COST, 0);
+				large.diff(ALGORITHMS[i], edscriptLarge);
+				if (large.truncated() || edscriptLarge != edscriptUnlimited)
+				{
+					printf("%s: a cost limit of %ld changes the diff, iteration %d\n", ALGORITHM_NAMES[i], LARGE_COST, iteration);
+					++failures;
+				}
+			}
+		}
+		return failures;
+	}
+}
+
+int main()
+{
+	const int failures = TestCachedHashes() + TestLimits();
+	printf("difftest: %s\n", failures == 0 ? "ok" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
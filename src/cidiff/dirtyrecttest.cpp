@@ -0,0 +1,129 @@
+// Checks the rectangles CImgMergeBuffer reports for repainting: selecting a diff, copying
+// it and pasting an image must each give exactly the rectangles of the tiles they change,
+// and taking the rectangles again must give none until something else changes.
+#include "ImgMergeBuffer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	// wider and taller than one tile of COMPOSE_TILE_SIZE, with partial tiles at the edges
+	const int WIDTH = 700, HEIGHT = 600;
+	const int BLOCK_SIZE = 8;
+
+	int failures = 0;
+
+	Image FilledImage(int width, int height, unsigned char value)
+	{
+		Image image(width, height);
+		for (int y = 0; y < height; ++y)
+		{
+			unsigned char *scanline = image.scanLine(y);
+			for (int x = 0; x < width * 4; ++x)
+				scanline[x] = value;
+		}
+		return image;
+	}
+
+	bool RectLess(const Rect<int>& a, const Rect<int>& b)
+	{
+		if (a.top != b.top)
+			return a.top < b.top;
+		if (a.left != b.left)
+			return a.left < b.left;
+		if (a.bottom != b.bottom)
+			return a.bottom < b.bottom;
+		return a.right < b.right;
+	}
+
+	bool RectEqual(const Rect<int>& a, const Rect<int>& b)
+	{
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	// Takes the rectangles of every pane, which must be expected in any order, and then again,
+	// which must give none
+	void Check(CImgMergeBuffer& buffer, const char *step, std::vector<Rect<int> > expected)
+	{
+		std::sort(expected.begin(), expected.end(), RectLess);
+		for (int pane = 0; pane < buffer.GetPaneCount(); ++pane)
+		{
+			std::vector<Rect<int> > rects = buffer.TakeDirtyRects(pane);
+			std::sort(rects.begin(), rects.end(), RectLess);
+			if (rects.size() != expected.size() || !std::equal(rects.begin(), rects.end(), expected.begin(), RectEqual))
+			{
+				printf("%s: pane %d has %d rectangles:", step, pane, static_cast<int>(rects.size()));
+				for (const auto& rc : rects)
+					printf(" (%d,%d)-(%d,%d)", rc.left, rc.top, rc.right, rc.bottom);
+				printf("\n");
+				++failures;
+			}
+			if (!buffer.TakeDirtyRects(pane).empty())
+			{
+				printf("%s: pane %d has rectangles left after taking them\n", step, pane);
+				++failures;
+			}
+		}
+	}
+
+	// The rectangle of the pixels of the blocks under the pixels left, top, right, bottom
+	Rect<int> BlockRect(int left, int top, int right, int bottom)
+	{
+		return Rect<int>(left / BLOCK_SIZE * BLOCK_SIZE, top / BLOCK_SIZE * BLOCK_SIZE,
+			(right + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE, (bottom + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE);
+	}
+}
+
+int main()
+{
+	CImgMergeBuffer buffer;
+	buffer.NewImages(2, 1, WIDTH, HEIGHT);
+	buffer.SetDiffBlockSize(BLOCK_SIZE);
+	buffer.CompareImages();
+	for (int pane = 0; pane < 2; ++pane)
+	{
+		buffer.ComposeRect(pane, 0, 0, WIDTH, HEIGHT);
+		buffer.TakeDirtyRects(pane);
+	}
+
+	// a diff inside one tile
+	buffer.PasteImage(1, 300, 100, FilledImage(20, 10, 0xff));
+	const Rect<int> diff = BlockRect(300, 100, 320, 110);
+	Check(buffer, "PasteImage", { diff });
+	if (buffer.GetDiffCount() != 1)
+	{
+		printf("PasteImage: %d diffs instead of 1\n", buffer.GetDiffCount());
+		return 1;
+	}
+
+	buffer.SelectDiff(0);
+	Check(buffer, "SelectDiff(0)", { diff });
+	buffer.SelectDiff(0);
+	Check(buffer, "SelectDiff(0) again", {});
+	buffer.SelectDiff(-1);
+	Check(buffer, "SelectDiff(-1)", { diff });
+
+	buffer.CopyDiff(0, 0, 1);
+	Check(buffer, "CopyDiff", { diff });
+	if (buffer.GetDiffCount() != 0)
+	{
+		printf("CopyDiff: %d diffs left\n", buffer.GetDiffCount());
+		++failures;
+	}
+
+	// a diff over the corner of four tiles, so one rectangle in each
+	const int tile = CImgDiffBuffer::COMPOSE_TILE_SIZE;
+	buffer.PasteImage(0, tile - 5, tile - 5, FilledImage(10, 10, 0x80));
+	const Rect<int> corner = BlockRect(tile - 5, tile - 5, tile + 5, tile + 5);
+	Check(buffer, "PasteImage over four tiles", {
+		Rect<int>(corner.left, corner.top, tile, tile), Rect<int>(tile, corner.top, corner.right, tile),
+		Rect<int>(corner.left, tile, tile, corner.bottom), Rect<int>(tile, tile, corner.right, corner.bottom) });
+
+	// pasting the same pixels again changes nothing
+	buffer.PasteImage(0, tile - 5, tile - 5, FilledImage(10, 10, 0x80));
+	Check(buffer, "PasteImage of the same pixels", {});
+
+	printf("dirtyrecttest: %s\n", failures == 0 ? "ok" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
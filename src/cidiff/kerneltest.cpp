@@ -0,0 +1,187 @@
+// Checks that the SIMD kernels of ImgDiffKernels.hpp give the same results as the scalar
+// ones on random spans. Instruction sets the CPU does not support are skipped.
+#include "ImgDiffKernels.hpp"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace ImgDiffKernels;
+
+namespace
+{
+	const unsigned BLOCK_SIZES[] = { 1, 2, 3, 4, 5, 7, 8, 12, 16, 24, 32, 64 };
+	const int THRESHOLDS2[] = { 0, 1, 25, 300, 10000, 1000000 };
+
+	std::mt19937 rng(20240521);
+
+	unsigned Random(unsigned n)
+	{
+		return static_cast<unsigned>(rng() % n);
+	}
+
+	std::vector<unsigned char> RandomPixels(unsigned width)
+	{
+		std::vector<unsigned char> pixels(width * 4 + 1);
+		for (auto& c : pixels)
+			c = static_cast<unsigned char>(rng());
+		// some fully transparent pixels for the blend kernels
+		for (unsigned i = 0; i < width; ++i)
+		{
+			if (Random(5) == 0)
+				pixels[i * 4 + 3] = 0;
+		}
+		return pixels;
+	}
+
+	// A copy of pixels with a few channels changed a little, so that the threshold compares
+	// see both sides of their threshold
+	std::vector<unsigned char> Perturb(const std::vector<unsigned char>& pixels, unsigned width)
+	{
+		std::vector<unsigned char> result(pixels);
+		const unsigned changes = Random(4) == 0 ? 0 : 1 + Random(width / 4 + 1);
+		for (unsigned i = 0; i < changes && width > 0; ++i)
+		{
+			const unsigned j = Random(width * 4);
+			result[j] = static_cast<unsigned char>(result[j] + (Random(2) ? 1 + Random(8) : Random(256)));
+		}
+		return result;
+	}
+
+	ColorDistanceWeights RandomWeights()
+	{
+		if (Random(3) == 0)
+			return ColorDistanceWeights::Unit();
+		const auto w = []() { return static_cast<short>(Random(4) == 0 ? 0 : Random(MAX_COLOR_DISTANCE_WEIGHT + 1)); };
+		return { w(), w(), w(), w() };
+	}
+
+	int failures = 0;
+
+	void Check(bool ok, const char *kernel, ISA isa, unsigned width)
+	{
+		if (ok)
+			return;
+		if (failures < 20)
+			printf("%s: mismatch on ISA %d, width %u\n", kernel, isa, width);
+		++failures;
+	}
+
+	void TestMarkDiffBlocks(const Kernels& scalar, const Kernels& k, unsigned width)
+	{
+		const std::vector<unsigned char> line1 = RandomPixels(width);
+		const std::vector<unsigned char> line2 = Perturb(line1, width);
+		const unsigned blockSize = BLOCK_SIZES[Random(sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]))];
+		const unsigned x = Random(3) == 0 ? 0 : Random(100);
+		const int threshold2 = THRESHOLDS2[Random(sizeof(THRESHOLDS2) / sizeof(THRESHOLDS2[0]))];
+		const ColorDistanceWeights weights = RandomWeights();
+		std::vector<int> blocks1((x + width) / blockSize + 1);
+		for (auto& b : blocks1)
+			b = Random(8) == 0 ? -1 : 0;
+		std::vector<int> blocks2(blocks1);
+		const bool pow2 = IsPowerOfTwo(blockSize);
+
+		(pow2 ? scalar.markDiffBlocksExactPow2 : scalar.markDiffBlocksExact)(line1.data(), line2.data(), width, x, blockSize, blocks1.data());
+		(pow2 ? k.markDiffBlocksExactPow2 : k.markDiffBlocksExact)(line1.data(), line2.data(), width, x, blockSize, blocks2.data());
+		Check(blocks1 == blocks2, pow2 ? "markDiffBlocksExactPow2" : "markDiffBlocksExact", k.isa, width);
+
+		(pow2 ? scalar.markDiffBlocksThresholdPow2 : scalar.markDiffBlocksThreshold)(line1.data(), line2.data(), width, x, blockSize, blocks1.data(), threshold2, weights);
+		(pow2 ? k.markDiffBlocksThresholdPow2 : k.markDiffBlocksThreshold)(line1.data(), line2.data(), width, x, blockSize, blocks2.data(), threshold2, weights);
+		Check(blocks1 == blocks2, pow2 ? "markDiffBlocksThresholdPow2" : "markDiffBlocksThreshold", k.isa, width);
+
+		// the non-power-of-two kernels have to work for any block size
+		(scalar.markDiffBlocksThreshold)(line1.data(), line2.data(), width, x, blockSize, blocks1.data(), threshold2, weights);
+		(k.markDiffBlocksThreshold)(line1.data(), line2.data(), width, x, blockSize, blocks2.data(), threshold2, weights);
+		Check(blocks1 == blocks2, "markDiffBlocksThreshold", k.isa, width);
+
+		Check(scalar.equalsThreshold(line1.data(), line2.data(), width, threshold2, weights) ==
+			k.equalsThreshold(line1.data(), line2.data(), width, threshold2, weights), "equalsThreshold", k.isa, width);
+	}
+
+	void TestOrMasks(const Kernels& scalar, const Kernels& k, unsigned count)
+	{
+		std::vector<uint64_t> mask1(count), mask2(count), result1(count), result2(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			mask1[i] = (static_cast<uint64_t>(rng()) << 32) | rng();
+			mask2[i] = (static_cast<uint64_t>(rng()) << 32) | rng();
+		}
+		scalar.orMasks(mask1.data(), mask2.data(), result1.data(), count);
+		k.orMasks(mask1.data(), mask2.data(), result2.data(), count);
+		Check(result1 == result2, "orMasks", k.isa, count);
+	}
+
+	void TestBlend(const Kernels& scalar, const Kernels& k, unsigned width)
+	{
+		const std::vector<unsigned char> src = RandomPixels(width);
+		const std::vector<unsigned char> dst = RandomPixels(width);
+		const unsigned alpha = Random(4) == 0 ? (Random(2) ? 0 : 256) : Random(257);
+		const unsigned char b = static_cast<unsigned char>(rng()), g = static_cast<unsigned char>(rng()), r = static_cast<unsigned char>(rng());
+
+		std::vector<unsigned char> dst1(dst), dst2(dst);
+		const bool transparent1 = scalar.blendColor(dst1.data(), width, b, g, r, alpha);
+		const bool transparent2 = k.blendColor(dst2.data(), width, b, g, r, alpha);
+		Check(dst1 == dst2 && transparent1 == transparent2, "blendColor", k.isa, width);
+
+		dst1 = dst2 = dst;
+		scalar.blend(dst1.data(), src.data(), width, alpha);
+		k.blend(dst2.data(), src.data(), width, alpha);
+		Check(dst1 == dst2, "blend", k.isa, width);
+
+		dst1 = dst2 = dst;
+		scalar.xorColor(dst1.data(), src.data(), width);
+		k.xorColor(dst2.data(), src.data(), width);
+		Check(dst1 == dst2, "xorColor", k.isa, width);
+	}
+
+	void TestReduceHalf(const Kernels& scalar, const Kernels& k, unsigned width)
+	{
+		const std::vector<unsigned char> src0 = RandomPixels(width * 2);
+		const std::vector<unsigned char> src1 = Random(8) == 0 ? std::vector<unsigned char>(width * 8 + 1, 255) : RandomPixels(width * 2);
+		std::vector<unsigned char> dst1(width * 4 + 1, 7), dst2(width * 4 + 1, 7);
+		scalar.reduceHalf(dst1.data(), src0.data(), src1.data(), width);
+		k.reduceHalf(dst2.data(), src0.data(), src1.data(), width);
+		Check(dst1 == dst2, "reduceHalf", k.isa, width);
+	}
+
+	void TestHashLine(const Kernels& scalar, const Kernels& k, unsigned width)
+	{
+		const uint32_t CHANNEL_MASKS[] = { 0xffffffffu, 0x00ffffffu, 0xff00ff00u, 0x000000ffu, 0u };
+		const unsigned QUANTA[] = { 0, 1, 2, 3, 7, 40, 255, 256, 1000 };
+		const std::vector<unsigned char> line = RandomPixels(width);
+		const uint32_t channelMask = CHANNEL_MASKS[Random(sizeof(CHANNEL_MASKS) / sizeof(CHANNEL_MASKS[0]))];
+		const unsigned quantum = QUANTA[Random(sizeof(QUANTA) / sizeof(QUANTA[0]))];
+		Check(scalar.hashLine(line.data(), width, channelMask, quantum) == k.hashLine(line.data(), width, channelMask, quantum),
+			"hashLine", k.isa, width);
+	}
+}
+
+int main()
+{
+	const Kernels scalar = GetKernels(ISA_SCALAR);
+	const ISA isas[] = { ISA_SSE2, ISA_AVX2, ISA_NEON };
+	const char *names[] = { "scalar", "SSE2", "AVX2", "NEON" };
+	for (ISA isa : isas)
+	{
+		const Kernels k = GetKernels(isa);
+		if (k.isa != isa)
+		{
+			printf("%s: not supported, skipped\n", names[isa]);
+			continue;
+		}
+		const int before = failures;
+		for (int iteration = 0; iteration < 100; ++iteration)
+		{
+			for (unsigned width = 0; width < 150; ++width)
+			{
+				TestMarkDiffBlocks(scalar, k, width);
+				TestOrMasks(scalar, k, width % 40);
+				TestBlend(scalar, k, width);
+				TestReduceHalf(scalar, k, width);
+				TestHashLine(scalar, k, width);
+			}
+		}
+		printf("%s: %s\n", names[isa], failures == before ? "ok" : "FAILED");
+	}
+	return failures == 0 ? 0 : 1;
+}